@@ -0,0 +1,89 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// sends a ttopt command line to a server started with "ttopt -L <socket>" and prints its output and errors
+// to the standard output and error as ttopt would
+// the socket is $TTOPT_SOCKET, or /tmp/ttopt.sock
+// with -g first, the .names read from the standard input are optimized against the BLIF and sim given, and printed
+// ttopt itself is run instead if no server is listening, except for -g
+int main(int argc, char **argv) {
+  bool fGroup = argc > 1 && std::string(argv[1]) == "-g";
+  char const *sockname = getenv("TTOPT_SOCKET");
+  if(!sockname) {
+    sockname = "/tmp/ttopt.sock";
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, sockname, sizeof(addr.sun_path) - 1);
+  if(fd < 0 || connect(fd, (sockaddr *)&addr, sizeof(addr)) < 0) {
+    if(!fGroup) {
+      argv[0] = (char *)"ttopt";
+      execvp(argv[0], argv);
+    }
+    std::cerr << "cannot connect to " << sockname << std::endl;
+    return 1;
+  }
+  char cwd[PATH_MAX];
+  if(!getcwd(cwd, sizeof(cwd))) {
+    std::cerr << "cannot get the working directory" << std::endl;
+    return 1;
+  }
+  std::stringstream ss;
+  ss << (fGroup? "group": "run") << std::endl;
+  ss << cwd << std::endl;
+  for(int i = fGroup? 2: 1; i < argc; i++) {
+    ss << argv[i] << std::endl;
+  }
+  ss << std::endl;
+  if(fGroup) {
+    ss << std::cin.rdbuf();
+  }
+  std::string request = ss.str();
+  for(size_t pos = 0; pos < request.size();) {
+    ssize_t n = write(fd, request.data() + pos, request.size() - pos);
+    if(n <= 0) {
+      std::cerr << "cannot send to " << sockname << std::endl;
+      return 1;
+    }
+    pos += n;
+  }
+  shutdown(fd, SHUT_WR);
+  std::string reply;
+  char buf[1 << 16];
+  ssize_t n;
+  while((n = read(fd, buf, sizeof(buf))) > 0) {
+    reply.append(buf, n);
+  }
+  close(fd);
+  // the output and error of the job, each as "<stream> <length>" and its bytes, then its exit status
+  size_t pos = 0;
+  for(char const *stream: {"out", "err"}) {
+    size_t eol = reply.find('\n', pos);
+    std::string header = reply.substr(pos, eol == std::string::npos? 0: eol - pos);
+    if(header.compare(0, 4, std::string(stream) + " ")) {
+      std::cerr << "no reply from " << sockname << std::endl;
+      return 1;
+    }
+    size_t n = std::strtoull(header.c_str() + 4, NULL, 10);
+    if(reply.size() - eol - 1 < n) {
+      std::cerr << "truncated reply from " << sockname << std::endl;
+      return 1;
+    }
+    (std::string(stream) == "out"? std::cout: std::cerr) << reply.substr(eol + 1, n);
+    pos = eol + 1 + n;
+  }
+  if(reply.compare(pos, 7, "status ")) {
+    std::cerr << "no reply from " << sockname << std::endl;
+    return 1;
+  }
+  return std::atoi(reply.c_str() + pos + 7);
+}
@@ -0,0 +1,68 @@
+#ifndef TTOPT_H
+#define TTOPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TTOPT_API __attribute__((visibility("default")))
+
+/* options of the optimization of a group, as the command line options of ttopt */
+typedef struct ttopt_params {
+  int nRounds;             /* random sifting rounds, -n [default = 20] */
+  int fWarmStart;          /* start sifting from the order of an earlier group sharing inputs, -w */
+  char const *strategies;  /* comma-separated portfolio, -p, NULL for the default flow */
+  double budget;           /* seconds per group, -t, 0 for no limit */
+  long long nBudgetBytes;  /* bytes of tables per group, -m, 0 for no limit */
+} ttopt_params;
+
+/* a group of LUTs sharing their inputs
+   the function is given either as tables, nOutputs bitsets of 2^nInputs bits, each padded to a whole number of
+   64-bit words, bit m of an output being its value on the minterm m with input 0 as the most significant bit,
+   or as onsets, nOnsets[i] minterms for output i
+   pats points to nInputs columns of nBPats bytes in the sim format, bit j of byte b being pattern 8b+j,
+   and may be NULL with nBPats 0, in which case every minterm is a don't care as in ttopt without a sim
+   nothing is copied from pats, which must stay valid during the call */
+typedef struct ttopt_group {
+  int nInputs;
+  int nOutputs;
+  char const *const *inputs;
+  char const *const *outputs;
+  uint64_t const *tables;
+  int const *const *onsets;
+  int const *nOnsets;
+  char const *const *pats;
+  int nBPats;
+  int rarity;              /* patterns seen fewer times are don't cares */
+} ttopt_group;
+
+/* resources kept across calls: a pool of nThreads threads if any, the result cache of cachedir if not NULL,
+   and the orders of recent groups for fWarmStart
+   a context may be used by several threads at once
+   ttopt_ctx_new returns NULL if a strategy is unknown or the context cannot be created, as when the cache fails to open */
+typedef struct ttopt_ctx ttopt_ctx;
+
+TTOPT_API void ttopt_default_params(ttopt_params *params);
+TTOPT_API ttopt_ctx *ttopt_ctx_new(ttopt_params const *params, int nThreads, char const *cachedir, long long nCacheBytes);
+TTOPT_API void ttopt_ctx_free(ttopt_ctx *ctx);
+
+/* optimizes the group and writes its .names to blif, at most nBlif bytes including the terminating zero
+   returns the length of the result, which did not fit if it is nBlif or more, and can then be fetched with
+   ttopt_last_result by the same thread without optimizing again, or -1 if the group is malformed, as with a minterm
+   out of range, or if the optimization failed, as by running out of memory
+   nNodes and nStatus may be NULL, otherwise they receive the number of .names written and the status
+   (0 within budget, 1 if the search ran over it, 2 if the original cover was written) */
+TTOPT_API long long ttopt_optimize(ttopt_ctx *ctx, ttopt_group const *group, char *blif, size_t nBlif, int *nNodes, int *nStatus);
+
+/* copies the last result of the calling thread that did not fit as ttopt_optimize does, returns its length, 0 if none,
+   -1 on failure */
+TTOPT_API long long ttopt_last_result(ttopt_ctx *ctx, char *blif, size_t nBlif);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
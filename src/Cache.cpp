@@ -0,0 +1,128 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <unistd.h>
+
+#include "Cache.h"
+
+namespace fs = std::filesystem;
+
+static const std::string header = "ttopt-cache 1";
+
+ResultCache::ResultCache(std::string const &dirname, long long nMaxBytes): dirname(dirname), nMaxBytes(nMaxBytes), nBytes(0) {
+  fs::create_directories(dirname);
+  for(auto const &entry: fs::directory_iterator(dirname)) {
+    if(entry.is_regular_file()) {
+      nBytes += entry.file_size();
+    }
+  }
+}
+
+// FNV-1a
+uint64_t ResultCache::Hash(void const *p, size_t size, uint64_t seed) {
+  uint64_t h = 0xcbf29ce484222325ull ^ seed;
+  unsigned char const *q = (unsigned char const *)p;
+  for(size_t i = 0; i < size; i++) {
+    h ^= q[i];
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+// the BLIF is returned only if it was written for the same signal names
+bool ResultCache::Lookup(std::string const &key, std::string const &namekey, std::string &engine, std::vector<int> &vLevels, std::string &blif) {
+  fs::path path = fs::path(dirname) / key;
+  std::ifstream f(path);
+  if(!f) {
+    return false;
+  }
+  std::string str;
+  if(!std::getline(f, str) || str != header) {
+    return false;
+  }
+  std::getline(f, engine);
+  std::getline(f, str);
+  {
+    std::stringstream ss(str);
+    vLevels.clear();
+    int lev;
+    while(ss >> lev) {
+      vLevels.push_back(lev);
+    }
+  }
+  std::string namekey2;
+  std::getline(f, namekey2);
+  blif.clear();
+  if(namekey2 == namekey) {
+    std::stringstream ss;
+    ss << f.rdbuf();
+    blif = ss.str();
+  }
+  if(!f.good() && !f.eof()) {
+    return false;
+  }
+  std::error_code ec;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+  return true;
+}
+
+void ResultCache::Insert(std::string const &key, std::string const &namekey, std::string const &engine, std::vector<int> const &vLevels, std::string const &blif) {
+  fs::path path = fs::path(dirname) / key;
+  std::stringstream name;
+  name << key << "." << getpid() << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << ".tmp";
+  fs::path tmppath = fs::path(dirname) / name.str();
+  {
+    std::ofstream f(tmppath);
+    f << header << std::endl;
+    f << engine << std::endl;
+    for(int lev: vLevels) {
+      f << lev << " ";
+    }
+    f << std::endl;
+    f << namekey << std::endl;
+    f << blif;
+  }
+  std::error_code ec;
+  long long size = fs::file_size(tmppath, ec);
+  fs::rename(tmppath, path, ec);
+  if(ec) {
+    fs::remove(tmppath, ec);
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    nBytes += size;
+    if(nBytes <= nMaxBytes) {
+      return;
+    }
+  }
+  Evict();
+}
+
+// removes the least recently used entries until the directory is below 90% of its limit
+void ResultCache::Evict() {
+  std::unique_lock<std::mutex> lock(mtx);
+  std::vector<std::pair<fs::file_time_type, fs::path> > entries;
+  std::error_code ec;
+  nBytes = 0;
+  for(auto const &entry: fs::directory_iterator(dirname, ec)) {
+    if(entry.is_regular_file(ec)) {
+      entries.push_back({entry.last_write_time(ec), entry.path()});
+      nBytes += entry.file_size(ec);
+    }
+  }
+  std::sort(entries.begin(), entries.end());
+  for(auto const &entry: entries) {
+    if(nBytes <= nMaxBytes * 9 / 10) {
+      break;
+    }
+    long long size = fs::file_size(entry.second, ec);
+    if(fs::remove(entry.second, ec)) {
+      nBytes -= size;
+    }
+  }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <mutex>
+
+// on-disk cache of optimized groups, one file per key in a directory
+// files are written to a temporary name and renamed, so concurrent readers never see partial entries
+// hits refresh the modification time, and the oldest files are evicted when the directory grows beyond nMaxBytes
+class ResultCache {
+public:
+  ResultCache(std::string const &dirname, long long nMaxBytes);
+
+  static uint64_t Hash(void const *p, size_t size, uint64_t seed);
+
+  bool Lookup(std::string const &key, std::string const &namekey, std::string &engine, std::vector<int> &vLevels, std::string &blif);
+  void Insert(std::string const &key, std::string const &namekey, std::string const &engine, std::vector<int> const &vLevels, std::string const &blif);
+  void Evict();
+
+private:
+  std::string dirname;
+  long long nMaxBytes;
+  long long nBytes;
+  std::mutex mtx;
+};
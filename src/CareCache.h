@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <functional>
+
+// care sets computed from the patterns, keyed by the pattern columns of the inputs
+// the columns must stay valid while the cache is in use, which holds for mapped sim files
+// the oldest entries are dropped when the total size exceeds nMaxBytes
+class CareCache {
+public:
+  typedef std::vector<uint64_t> Care;
+
+  CareCache(long long nMaxBytes): nMaxBytes(nMaxBytes), nBytes(0) {}
+
+  std::shared_ptr<Care const> Get(std::vector<char *> const &pBPats, int nBPats, int rarity, std::function<Care()> const &Compute) {
+    Key key(pBPats, nBPats, rarity);
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      auto it = entries.find(key);
+      if(it != entries.end()) {
+        return it->second;
+      }
+    }
+    // computed outside the lock, a concurrent miss on the same key computes the same care
+    std::shared_ptr<Care const> care = std::make_shared<Care const>(Compute());
+    std::lock_guard<std::mutex> lock(mtx);
+    if(entries.count(key)) {
+      return care;
+    }
+    entries[key] = care;
+    order.push_back(key);
+    nBytes += care->size() * sizeof(uint64_t);
+    while(nBytes > nMaxBytes && !order.empty()) {
+      nBytes -= entries[order.front()]->size() * sizeof(uint64_t);
+      entries.erase(order.front());
+      order.pop_front();
+    }
+    return care;
+  }
+
+  // to be called when columns used as keys are freed, as their addresses may be reused
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mtx);
+    entries.clear();
+    order.clear();
+    nBytes = 0;
+  }
+
+private:
+  typedef std::tuple<std::vector<char *>, int, int> Key;
+  long long nMaxBytes;
+  long long nBytes;
+  std::map<Key, std::shared_ptr<Care const> > entries;
+  std::deque<Key> order;
+  std::mutex mtx;
+};
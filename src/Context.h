@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+
+class ThreadPool;
+class ResultCache;
+class CareCache;
+class OrderHints;
+struct VerifyStats;
+
+// node counts of a rarity sweep, summed over the groups of a layer, one per threshold of Params::vRarities
+struct SweepStats {
+  std::mutex mtx;
+  std::vector<long long> vNodes;
+};
+
+// groups of a layer that ran over their budget, as "<first output> order" if the search was cut short
+// and "<first output> cover" if their original cover was written
+struct BudgetStats {
+  std::mutex mtx;
+  std::vector<std::string> vFallbacks;
+};
+
+// resources shared by the groups of a run, any of them may be NULL
+struct Context {
+  ThreadPool *pPool = NULL;
+  ResultCache *pCache = NULL;
+  OrderHints *pHints = NULL;
+  VerifyStats *pVerify = NULL;
+  SweepStats *pSweep = NULL;
+  CareCache *pCareCache = NULL;
+  BudgetStats *pBudget = NULL;
+};
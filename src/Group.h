@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "PatternCounter.h"
+
+// a group of LUTs sharing the same inputs, as read by ReadBlifFuncs
+struct Group {
+  std::vector<std::string> inputs;
+  std::vector<std::string> outputs;
+  std::vector<std::vector<int> > onsets;
+  std::vector<char *> vpBPats;
+  int nBPats = 0;
+  // counts of the patterns when the sim is streamed, vpBPats is then empty
+  PatternCounter const *pCount = NULL;
+};
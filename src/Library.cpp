@@ -0,0 +1,187 @@
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <cstring>
+
+#include "ttopt.h"
+#include "Params.h"
+#include "ThreadPool.h"
+#include "Context.h"
+#include "Cache.h"
+#include "OrderHints.h"
+#include "PatternCounter.h"
+
+extern bool CheckStrategy(std::string const &strategy);
+extern int OptimizeGroupCached(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &pBPats, int nBPats, PatternCounter const *pCount, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f, Params const &params, Context const &ctx);
+
+// the care cache of the command line is not used, as it is keyed by the addresses of the columns,
+// which the caller may free and reuse between calls
+struct ttopt_ctx {
+  Params params;
+  std::unique_ptr<ThreadPool> pPool;
+  std::unique_ptr<ResultCache> pCache;
+  OrderHints hints;
+  Context ctx;
+  std::mutex mtx;
+  std::map<std::thread::id, std::string> results;
+};
+
+static long long CopyResult(std::string const &str, char *blif, size_t nBlif) {
+  if(blif && nBlif) {
+    size_t n = std::min(str.size(), nBlif - 1);
+    memcpy(blif, str.data(), n);
+    blif[n] = 0;
+  }
+  return str.size();
+}
+
+void ttopt_default_params(ttopt_params *params) {
+  Params defaults;
+  params->nRounds = defaults.nRounds;
+  params->fWarmStart = defaults.fWarmStart;
+  params->strategies = NULL;
+  params->budget = defaults.budget;
+  params->nBudgetBytes = defaults.nBudgetBytes;
+}
+
+static ttopt_ctx *NewContext(ttopt_params const *params, int nThreads, char const *cachedir, long long nCacheBytes) {
+  std::unique_ptr<ttopt_ctx> p(new ttopt_ctx);
+  if(params) {
+    p->params.nRounds = params->nRounds;
+    p->params.fWarmStart = params->fWarmStart;
+    p->params.budget = params->budget;
+    p->params.nBudgetBytes = params->nBudgetBytes;
+    std::stringstream ss(params->strategies? params->strategies: "");
+    std::string strategy;
+    while(std::getline(ss, strategy, ',')) {
+      if(!CheckStrategy(strategy)) {
+        return NULL;
+      }
+      p->params.vStrategies.push_back(strategy);
+    }
+  }
+  p->params.nThreads = nThreads;
+  p->params.fReport = false;
+  if(nThreads > 0) {
+    p->pPool.reset(new ThreadPool(nThreads));
+    p->ctx.pPool = p->pPool.get();
+  }
+  if(cachedir) {
+    p->params.cachename = cachedir;
+    if(nCacheBytes > 0) {
+      p->params.nCacheBytes = nCacheBytes;
+    }
+    p->pCache.reset(new ResultCache(p->params.cachename, p->params.nCacheBytes));
+    p->ctx.pCache = p->pCache.get();
+  }
+  if(p->params.fWarmStart) {
+    p->ctx.pHints = &p->hints;
+  }
+  return p.release();
+}
+
+static long long Optimize(ttopt_ctx *ctx, ttopt_group const *group, char *blif, size_t nBlif, int *nNodes, int *nStatus) {
+  int nInputs = group->nInputs;
+  int nOutputs = group->nOutputs;
+  if(nInputs < 0 || nInputs > 30 || nOutputs <= 0 || (!group->tables && (!group->onsets || !group->nOnsets)) || (group->nBPats && !group->pats)) {
+    return -1;
+  }
+  std::vector<std::string> inputs(group->inputs, group->inputs + nInputs);
+  std::vector<std::string> outputs(group->outputs, group->outputs + nOutputs);
+  // the engines build their own tables from the onsets, the columns are read in place
+  std::vector<std::vector<int> > onsets(nOutputs);
+  if(group->tables) {
+    long long nWords = std::max(1ll, (1ll << nInputs) >> 6);
+    for(int i = 0; i < nOutputs; i++) {
+      uint64_t const *table = group->tables + nWords * i;
+      for(long long j = 0; j < nWords; j++) {
+        for(uint64_t w = table[j]; w; w &= w - 1) {
+          long long pat = (j << 6) + __builtin_ctzll(w);
+          if(pat < (1ll << nInputs)) {
+            onsets[i].push_back(pat);
+          }
+        }
+      }
+    }
+  } else {
+    for(int i = 0; i < nOutputs; i++) {
+      if(group->nOnsets[i] < 0 || (group->nOnsets[i] && !group->onsets[i])) {
+        return -1;
+      }
+      onsets[i].assign(group->onsets[i], group->onsets[i] + group->nOnsets[i]);
+      // the engines index their tables by the minterms
+      for(int pat: onsets[i]) {
+        if(pat < 0 || pat >= (1ll << nInputs)) {
+          return -1;
+        }
+      }
+    }
+  }
+  std::vector<char *> vpBPats;
+  for(int i = 0; group->nBPats && i < nInputs; i++) {
+    vpBPats.push_back(const_cast<char *>(group->pats[i]));
+  }
+  std::stringstream ss;
+  int status = OptimizeGroupCached(onsets, vpBPats, group->nBPats, NULL, group->nBPats? group->rarity: 0, inputs, outputs, ss, ctx->params, ctx->ctx);
+  std::string str = ss.str();
+  if(nNodes) {
+    // every node starts a .names line
+    *nNodes = 0;
+    for(size_t pos = str.find(".names"); pos != std::string::npos; pos = str.find(".names", pos + 1)) {
+      (*nNodes)++;
+    }
+  }
+  if(nStatus) {
+    *nStatus = status;
+  }
+  long long n = CopyResult(str, blif, nBlif);
+  std::lock_guard<std::mutex> lock(ctx->mtx);
+  if(n >= (long long)nBlif) {
+    ctx->results[std::this_thread::get_id()] = std::move(str);
+  } else {
+    ctx->results.erase(std::this_thread::get_id());
+  }
+  return n;
+}
+
+static long long LastResult(ttopt_ctx *ctx, char *blif, size_t nBlif) {
+  std::lock_guard<std::mutex> lock(ctx->mtx);
+  auto it = ctx->results.find(std::this_thread::get_id());
+  if(it == ctx->results.end()) {
+    return 0;
+  }
+  return CopyResult(it->second, blif, nBlif);
+}
+
+// nothing is thrown across the C interface, running out of memory or failing to open the cache is reported as an error
+ttopt_ctx *ttopt_ctx_new(ttopt_params const *params, int nThreads, char const *cachedir, long long nCacheBytes) {
+  try {
+    return NewContext(params, nThreads, cachedir, nCacheBytes);
+  } catch(...) {
+    return NULL;
+  }
+}
+
+void ttopt_ctx_free(ttopt_ctx *ctx) {
+  delete ctx;
+}
+
+long long ttopt_optimize(ttopt_ctx *ctx, ttopt_group const *group, char *blif, size_t nBlif, int *nNodes, int *nStatus) {
+  try {
+    return Optimize(ctx, group, blif, nBlif, nNodes, nStatus);
+  } catch(...) {
+    return -1;
+  }
+}
+
+long long ttopt_last_result(ttopt_ctx *ctx, char *blif, size_t nBlif) {
+  try {
+    return LastResult(ctx, blif, nBlif);
+  } catch(...) {
+    return -1;
+  }
+}
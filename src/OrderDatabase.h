@@ -0,0 +1,125 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <cstdio>
+#include <cctype>
+
+// best orders of small groups by the permutation class of their tables and care set, shared by all groups
+// an order is stored relative to the canonical order of the class, level vOrder[c] for the input at level c in it
+// the file lists one class per line as its key in hex followed by the order
+class OrderDatabase {
+public:
+  OrderDatabase(size_t nMaxEntries = 1 << 20): nMaxEntries(nMaxEntries) {}
+
+  bool Lookup(std::string const &key, std::vector<int> &vOrder) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(key);
+    if(it == entries.end()) {
+      return false;
+    }
+    vOrder = it->second;
+    return true;
+  }
+
+  // classes beyond nMaxEntries are not recorded
+  void Insert(std::string const &key, std::vector<int> const &vOrder) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if(entries.size() < nMaxEntries) {
+      entries.emplace(key, vOrder);
+    }
+  }
+
+  size_t Size() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return entries.size();
+  }
+
+  // returns false if the file cannot be opened
+  // lines that do not parse whole, or whose order is not a permutation, are skipped as if the file was cut there
+  bool Read(std::string const &filename) {
+    std::ifstream f(filename);
+    if(!f) {
+      return false;
+    }
+    std::string line;
+    while(std::getline(f, line)) {
+      std::stringstream ss(line);
+      std::string hex;
+      if(!(ss >> hex) || hex.size() % 2) {
+        continue;
+      }
+      std::string key(hex.size() / 2, 0);
+      bool fValid = true;
+      for(size_t i = 0; i < key.size() && fValid; i++) {
+        int hi = HexDigit(hex[2 * i]);
+        int lo = HexDigit(hex[2 * i + 1]);
+        fValid = hi >= 0 && lo >= 0;
+        key[i] = (hi << 4) | lo;
+      }
+      std::vector<int> vOrder;
+      int lev;
+      while(ss >> lev) {
+        vOrder.push_back(lev);
+      }
+      // the levels stop at the end of the line only
+      if(fValid && ss.eof() && IsPermutation(vOrder)) {
+        Insert(key, vOrder);
+      }
+    }
+    return true;
+  }
+
+  // written to a temporary name and renamed, as for the result cache
+  bool Write(std::string const &filename) {
+    std::string tmpname = filename + ".tmp";
+    {
+      std::ofstream f(tmpname);
+      std::lock_guard<std::mutex> lock(mtx);
+      for(auto const &entry: entries) {
+        char buf[3];
+        for(unsigned char c: entry.first) {
+          snprintf(buf, sizeof(buf), "%02x", c);
+          f << buf;
+        }
+        for(int lev: entry.second) {
+          f << " " << lev;
+        }
+        f << "\n";
+      }
+      if(!f) {
+        return false;
+      }
+    }
+    return std::rename(tmpname.c_str(), filename.c_str()) == 0;
+  }
+
+private:
+  size_t nMaxEntries;
+
+  static int HexDigit(char c) {
+    if(!isxdigit((unsigned char)c)) {
+      return -1;
+    }
+    return isdigit((unsigned char)c)? c - '0': tolower((unsigned char)c) - 'a' + 10;
+  }
+
+  // the orders are applied as levels of the inputs, each level once
+  static bool IsPermutation(std::vector<int> const &vOrder) {
+    std::vector<bool> vSeen(vOrder.size());
+    for(int lev: vOrder) {
+      if(lev < 0 || lev >= (int)vOrder.size() || vSeen[lev]) {
+        return false;
+      }
+      vSeen[lev] = true;
+    }
+    return !vOrder.empty();
+  }
+
+  std::unordered_map<std::string, std::vector<int> > entries;
+  std::mutex mtx;
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <numeric>
+
+// best orders of recently optimized groups, used to seed the sifting of groups sharing inputs with them
+class OrderHints {
+public:
+  OrderHints(int nMaxRecords = 64): nMaxRecords(nMaxRecords) {}
+
+  void Record(std::vector<std::string> const &inputs, std::vector<int> const &vLevels) {
+    if(inputs.size() != vLevels.size()) {
+      return;
+    }
+    std::map<std::string, int> levels;
+    for(unsigned i = 0; i < inputs.size(); i++) {
+      levels[inputs[i]] = vLevels[i];
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    records.push_front({(int)inputs.size(), levels});
+    if((int)records.size() > nMaxRecords) {
+      records.pop_back();
+    }
+  }
+
+  // returns the order of the most overlapping record mapped onto inputs, or empty if less than half of inputs are shared
+  // inputs missing from the record keep their relative position in the identity order
+  std::vector<int> Lookup(std::vector<std::string> const &inputs) {
+    int nInputs = inputs.size();
+    std::vector<double> keys(nInputs);
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      Entry const *best = NULL;
+      int nBest = 0;
+      for(auto const &record: records) {
+        int n = 0;
+        for(auto const &input: inputs) {
+          n += record.levels.count(input);
+        }
+        if(nBest < n) {
+          nBest = n;
+          best = &record;
+        }
+      }
+      if(!best || nBest < 2 || 2 * nBest < nInputs) {
+        return {};
+      }
+      // levels are scaled to [0, 1) so that groups of different sizes mix
+      for(int i = 0; i < nInputs; i++) {
+        auto it = best->levels.find(inputs[i]);
+        if(it == best->levels.end()) {
+          keys[i] = (double)i / nInputs;
+        } else {
+          keys[i] = (double)it->second / best->nInputs;
+        }
+      }
+    }
+    std::vector<int> vars(nInputs);
+    std::iota(vars.begin(), vars.end(), 0);
+    std::stable_sort(vars.begin(), vars.end(), [&](int i1, int i2) { return keys[i1] < keys[i2]; });
+    std::vector<int> vLevels(nInputs);
+    for(int i = 0; i < nInputs; i++) {
+      vLevels[vars[i]] = i;
+    }
+    return vLevels;
+  }
+
+private:
+  struct Entry {
+    int nInputs;
+    std::map<std::string, int> levels;
+  };
+  int nMaxRecords;
+  std::deque<Entry> records;
+  std::mutex mtx;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct Params {
+  // portfolio of strategies "engine" or "sifter+engine", empty for the default flow
+  std::vector<std::string> vStrategies;
+  int nRounds = 20;
+  // reorder groups of 10 inputs or more by the island search of PopulationReo instead of random sifting
+  bool fPopulation = false;
+  // with a pool, sift each variable downward and upward at once, one round after another as without a pool
+  bool fBidirectional = false;
+  // reorder groups of up to 5 inputs, or 6 with one output, by trying all orders instead of random sifting
+  bool fExhaustive = false;
+  // start sifting from the order of an earlier group sharing most of the inputs
+  bool fWarmStart = false;
+  // number of worker threads, 0 to optimize groups one by one as they are read
+  int nThreads = 0;
+  // directory of the result cache, empty for no cache
+  std::string cachename;
+  long long nCacheBytes = 1ll << 30;
+  bool fCacheBlif = true;
+  // thresholds of a rarity sweep, empty for a single run with the default rarity
+  std::vector<int> vRarities;
+  // bytes per input of the slabs the sim is streamed in, 0 to map the whole sim
+  int nSlabBytes = 0;
+  // seconds per group for the search, after which it keeps its best order, and as many for Optimize,
+  // after which the original cover is written, 0 for no limit
+  double budget = 0;
+  // estimated bytes of tables per group, beyond which the original cover is written, 0 for no limit
+  long long nBudgetBytes = 0;
+  // merge the same nodes across the groups of a layer before writing it
+  bool fStrash = false;
+  // print the strategy winning the portfolio for every group
+  bool fReport = true;
+  // file of the best orders of small groups by permutation class, read at start and updated at exit, empty for none
+  std::string ordersname;
+  // simulate the result of every group against its onsets
+  bool fVerify = false;
+};
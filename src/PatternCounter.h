@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+// occurrence counts of input patterns, saturating at nCap
+// dense 8-bit counters if the patterns can cover a good part of the space, otherwise an open-addressing table of the patterns seen
+// caps beyond 8 bits fall back to dense 32-bit counters
+class PatternCounter {
+public:
+  PatternCounter(int nInputs, long long nPatterns, int nCap): nCap(std::max(nCap, 1)), nEntries(0) {
+    long long nSpace = 1ll << nInputs;
+    // a slot takes 8 bytes and the table is kept at most half full
+    fSparse = 16 * std::min(nPatterns, nSpace) < nSpace;
+    if(fSparse) {
+      slots.resize(64);
+    } else if(this->nCap <= 0xff) {
+      dense.resize(nSpace);
+    } else {
+      dense32.resize(nSpace);
+    }
+  }
+
+  // returns the count after adding pat n times
+  int Add(int pat, int n = 1) {
+    if(!fSparse) {
+      if(!dense32.empty()) {
+        dense32[pat] += std::min(n, nCap - dense32[pat]);
+        return dense32[pat];
+      }
+      dense[pat] += std::min(n, nCap - dense[pat]);
+      return dense[pat];
+    }
+    uint64_t &slot = Find(pat);
+    if(!slot) {
+      slot = (uint64_t)(pat + 1) << 32;
+      nEntries++;
+    }
+    slot += std::min(n, nCap - (int)(slot & 0xffffffff));
+    int count = slot & 0xffffffff;
+    if(2 * nEntries > slots.size()) {
+      Grow();
+    }
+    return count;
+  }
+
+  int Get(int pat) const {
+    if(!fSparse) {
+      return dense32.empty()? dense[pat]: dense32[pat];
+    }
+    return const_cast<PatternCounter *>(this)->Find(pat) & 0xffffffff;
+  }
+
+  // calls Func(pat, count) for every pattern seen
+  template <class F>
+  void ForEach(F Func) const {
+    if(!fSparse) {
+      for(size_t pat = 0; pat < dense.size(); pat++) {
+        if(dense[pat]) {
+          Func((int)pat, (int)dense[pat]);
+        }
+      }
+      for(size_t pat = 0; pat < dense32.size(); pat++) {
+        if(dense32[pat]) {
+          Func((int)pat, dense32[pat]);
+        }
+      }
+      return;
+    }
+    for(uint64_t slot: slots) {
+      if(slot) {
+        Func((int)(slot >> 32) - 1, (int)(slot & 0xffffffff));
+      }
+    }
+  }
+
+private:
+  int nCap;
+  bool fSparse;
+  size_t nEntries;
+  std::vector<uint8_t> dense;
+  std::vector<int> dense32;
+  std::vector<uint64_t> slots; // (pat + 1) << 32 | count, 0 if empty
+
+  uint64_t &Find(int pat) {
+    size_t mask = slots.size() - 1;
+    size_t i = ((uint64_t)pat * 0x9e3779b97f4a7c15ull) >> 20 & mask;
+    while(slots[i] && (int)(slots[i] >> 32) - 1 != pat) {
+      i = (i + 1) & mask;
+    }
+    return slots[i];
+  }
+
+  void Grow() {
+    std::vector<uint64_t> old(slots.size() * 2);
+    old.swap(slots);
+    for(uint64_t slot: old) {
+      if(slot) {
+        Find((int)(slot >> 32) - 1) = slot;
+      }
+    }
+  }
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// reads the patterns of a sim file in slabs covering all inputs, so that memory does not depend on the number of patterns
+// two formats are read:
+//   the plain one of MapSim, nInputs columns of nBPats bytes without a header
+//   a packed one starting with the magic "ttsim01\n", the number of inputs and the number of patterns as 64-bit integers,
+//   followed by one record of nInputs 64-bit words per 64 patterns, the last one padded with zeros
+// in both, bit j of byte b of an input is the value of the input in pattern 8b+j
+class PatternSource {
+public:
+  int nInputs;
+  long long nPatterns;
+
+  PatternSource(std::string const &filename, int nInputs, int nSlabBytes);
+  ~PatternSource();
+
+  static bool IsPacked(std::string const &filename);
+
+  // fills one column of nBytes bytes per input, holding nValid patterns, returns false at the end
+  bool Next(std::vector<char *> &vpBPats, int &nBytes, int &nValid);
+
+private:
+  int fd;
+  bool fPacked;
+  int nSlabBytes;
+  long long nColumnBytes;
+  long long nRead;
+  std::vector<std::vector<char> > vColumns;
+  std::vector<char> buffer;
+};
@@ -4,23 +4,30 @@
 #include <algorithm>
 #include <iomanip>
 
+#include "PatternCounter.h"
+
 extern std::string BinaryToString(int bin, int size);
 
 void GeneratePla(std::string filename, std::vector<std::vector<int> > const &onsets, std::vector<char *> const &pBPats, int nBPats, int rarity) {
   int LUTSize = pBPats.size();
   int nOutputs = onsets.size();
   std::vector<int> careset;
-  std::vector<int> count(1 << LUTSize);
   if(rarity == 0) {
+    long long nOnes = 0;
+    for(auto const &onset: onsets) {
+      nOnes += onset.size();
+    }
+    PatternCounter count(LUTSize, nOnes, 2);
     for(auto onset: onsets) {
       for(int pat: onset) {
-        if(!count[pat]) {
+        if(count.Add(pat) == 1) {
           careset.push_back(pat);
-          count[pat]++;
         }
       }
     }
   } else {
+    // saturating one above rarity so that each pattern reaches rarity once
+    PatternCounter count(LUTSize, 8ll * nBPats, rarity + 1);
     for(int i = 0; i < nBPats; i++) {
       for(int j = 0; j < 8; j++) {
         int pat = 0;
@@ -28,8 +35,7 @@ void GeneratePla(std::string filename, std::vector<std::vector<int> > const &ons
           pat <<= 1;
           pat |= ((pBPat[i] >> j) & 1);
         }
-        count[pat]++;
-        if(count[pat] == rarity) {
+        if(count.Add(pat) == rarity) {
           careset.push_back(pat);
         }
       }
@@ -41,7 +41,7 @@ void ReadBlifHeader(std::ifstream &f, std::string &modulename, std::vector<std::
   }
 }
 
-int ReadBlifFuncs(std::ifstream &f, int nGroupSize, std::vector<std::string> &LUTInputs, std::vector<std::string> &LUTOutputs, std::vector<std::vector<int> > &onsets) {
+int ReadBlifFuncs(std::istream &f, int nGroupSize, std::vector<std::string> &LUTInputs, std::vector<std::string> &LUTOutputs, std::vector<std::vector<int> > &onsets) {
   LUTInputs.clear();
   LUTOutputs.clear();
   onsets.clear();
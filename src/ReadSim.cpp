@@ -1,25 +1,224 @@
 #include <cstdio>
 #include <cstdlib>
 #include <string>
+#include <stdexcept>
 #include <vector>
-#include <cassert>
-
-void ReadSim(std::string filename, int nInputs, std::vector<char *> &vpBPats, int &nBPats) {
-  for(auto pBPats: vpBPats) {
-    free(pBPats);
-  }
-  vpBPats.clear();
-  FILE *pFile;
-  pFile = fopen (filename.c_str(), "rb");
-  fseek(pFile, 0, SEEK_END);
-  int size = ftell(pFile);
-  rewind(pFile);
-  nBPats = size / nInputs;
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "PatternSource.h"
+#include "PatternCounter.h"
+
+namespace {
+
+struct Mapping {
+  char *p;
+  size_t size;
+  ino_t ino;
+  timespec mtime;
+};
+
+std::mutex mapmtx;
+std::map<std::string, Mapping> mapped;
+std::vector<Mapping> stale;
+
+}
+
+// maps a sim file read-only and points vpBPats into it, each file is mapped once and stays mapped while it is unchanged
+// a file replaced or rewritten since it was mapped is mapped again, the old mapping is kept until ReleaseStaleSims
+void MapSim(std::string filename, int nInputs, std::vector<char *> &vpBPats, int &nBPats) {
+  if(nInputs <= 0) {
+    throw std::runtime_error("cannot read " + filename + " for a header without inputs");
+  }
+  Mapping m;
+  {
+    std::unique_lock<std::mutex> lock(mapmtx);
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0) {
+      throw std::runtime_error("cannot open " + filename);
+    }
+    struct stat st;
+    fstat(fd, &st);
+    // the columns are of the same length
+    if(st.st_size % nInputs) {
+      close(fd);
+      throw std::runtime_error(filename + " is not made of " + std::to_string(nInputs) + " columns");
+    }
+    char *path = realpath(filename.c_str(), NULL);
+    std::string key = path? path: filename;
+    free(path);
+    auto it = mapped.find(key);
+    if(it != mapped.end() && (it->second.ino != st.st_ino || it->second.size != (size_t)st.st_size || it->second.mtime.tv_sec != st.st_mtim.tv_sec || it->second.mtime.tv_nsec != st.st_mtim.tv_nsec)) {
+      stale.push_back(it->second);
+      mapped.erase(it);
+      it = mapped.end();
+    }
+    if(it == mapped.end()) {
+      m.size = st.st_size;
+      m.ino = st.st_ino;
+      m.mtime = st.st_mtim;
+      m.p = NULL;
+      if(m.size) {
+        m.p = (char *)mmap(NULL, m.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(m.p == MAP_FAILED) {
+          close(fd);
+          throw std::runtime_error("cannot map " + filename);
+        }
+      }
+      mapped[key] = m;
+    } else {
+      m = it->second;
+    }
+    close(fd);
+  }
+  nBPats = m.size / nInputs;
+  vpBPats.resize(nInputs);
+  for(int i = 0; i < nInputs; i++) {
+    vpBPats[i] = m.p + (size_t)i * nBPats;
+  }
+}
+
+// unmaps the mappings MapSim replaced, to be called when no columns into them are in use
+// returns the number released, the caller must drop anything keyed by their addresses
+int ReleaseStaleSims() {
+  std::unique_lock<std::mutex> lock(mapmtx);
+  int n = stale.size();
+  for(auto const &m: stale) {
+    if(m.p) {
+      munmap(m.p, m.size);
+    }
+  }
+  stale.clear();
+  return n;
+}
+
+static const char packedmagic[8] = {'t', 't', 's', 'i', 'm', '0', '1', '\n'};
+
+bool PatternSource::IsPacked(std::string const &filename) {
+  FILE *pFile = fopen(filename.c_str(), "rb");
+  if(!pFile) {
+    return false;
+  }
+  char magic[8];
+  bool r = fread(magic, 1, 8, pFile) == 8 && !memcmp(magic, packedmagic, 8);
+  fclose(pFile);
+  return r;
+}
+
+PatternSource::PatternSource(std::string const &filename, int nInputs, int nSlabBytes): nInputs(nInputs), nSlabBytes(nSlabBytes), nRead(0) {
+  if(nInputs <= 0) {
+    throw std::runtime_error("cannot read " + filename + " for a header without inputs");
+  }
+  fd = open(filename.c_str(), O_RDONLY);
+  if(fd < 0) {
+    throw std::runtime_error("cannot open " + filename);
+  }
+  struct stat st;
+  fstat(fd, &st);
+  fPacked = IsPacked(filename);
+  if(fPacked) {
+    uint64_t header[3];
+    if(pread(fd, header, sizeof(header), 0) != sizeof(header) || (int)header[1] != nInputs) {
+      close(fd);
+      throw std::runtime_error(filename + " does not have " + std::to_string(nInputs) + " inputs");
+    }
+    nPatterns = header[2];
+    // slabs are whole records
+    this->nSlabBytes = std::max(8, nSlabBytes / 8 * 8);
+  } else {
+    if(st.st_size % nInputs) {
+      close(fd);
+      throw std::runtime_error(filename + " is not made of " + std::to_string(nInputs) + " columns");
+    }
+    nColumnBytes = st.st_size / nInputs;
+    nPatterns = 8 * nColumnBytes;
+  }
+  vColumns.resize(nInputs, std::vector<char>(this->nSlabBytes));
+}
+
+PatternSource::~PatternSource() {
+  close(fd);
+}
+
+bool PatternSource::Next(std::vector<char *> &vpBPats, int &nBytes, int &nValid) {
+  if(nRead >= nPatterns) {
+    return false;
+  }
+  nValid = std::min((long long)8 * nSlabBytes, nPatterns - nRead);
+  nBytes = (nValid + 7) / 8;
+  if(fPacked) {
+    int nWords = (nValid + 63) / 64;
+    buffer.resize((size_t)nWords * nInputs * 8);
+    off_t offset = 24 + nRead / 64 * nInputs * 8;
+    if(pread(fd, buffer.data(), buffer.size(), offset) != (ssize_t)buffer.size()) {
+      throw std::runtime_error("truncated pattern file");
+    }
+    for(int w = 0; w < nWords; w++) {
+      for(int i = 0; i < nInputs; i++) {
+        memcpy(vColumns[i].data() + 8 * w, buffer.data() + ((size_t)w * nInputs + i) * 8, 8);
+      }
+    }
+  } else {
+    for(int i = 0; i < nInputs; i++) {
+      if(pread(fd, vColumns[i].data(), nBytes, i * nColumnBytes + nRead / 8) != nBytes) {
+        throw std::runtime_error("truncated pattern file");
+      }
+    }
+  }
   vpBPats.resize(nInputs);
   for(int i = 0; i < nInputs; i++) {
-    vpBPats[i] = (char *)malloc(nBPats);
-    int r = fread(vpBPats[i], 1, nBPats, pFile);
-    assert(r == nBPats);
+    vpBPats[i] = vColumns[i].data();
+  }
+  nRead += nValid;
+  return true;
+}
+
+// writes the patterns in the packed format of PatternSource
+void WriteSimPacked(std::string filename, std::vector<char *> const &vpBPats, int nBPats) {
+  int nInputs = vpBPats.size();
+  FILE *pFile = fopen(filename.c_str(), "wb");
+  if(!pFile) {
+    throw std::runtime_error("cannot open " + filename);
+  }
+  uint64_t header[2] = {(uint64_t)nInputs, 8ull * nBPats};
+  fwrite(packedmagic, 1, 8, pFile);
+  fwrite(header, 8, 2, pFile);
+  std::vector<char> record((size_t)nInputs * 8);
+  for(long long b = 0; b < nBPats; b += 8) {
+    std::fill(record.begin(), record.end(), 0);
+    int n = std::min(8ll, nBPats - b);
+    for(int i = 0; i < nInputs; i++) {
+      memcpy(record.data() + 8 * i, vpBPats[i] + b, n);
+    }
+    fwrite(record.data(), 1, record.size(), pFile);
   }
   fclose(pFile);
 }
+
+// counts the patterns of every group in one pass over source, vvInputs holds the indices of the inputs of each group in the sim
+void CountGroupPatterns(PatternSource &source, std::vector<std::vector<int> > const &vvInputs, std::vector<PatternCounter> &counters) {
+  std::vector<char *> vpBPats;
+  int nBytes, nValid;
+  while(source.Next(vpBPats, nBytes, nValid)) {
+    for(unsigned g = 0; g < vvInputs.size(); g++) {
+      for(int i = 0; i < nBytes; i++) {
+        for(int j = 0; j < 8 && 8 * i + j < nValid; j++) {
+          int pat = 0;
+          for(int input: vvInputs[g]) {
+            pat <<= 1;
+            pat |= (vpBPats[input][i] >> j) & 1;
+          }
+          counters[g].Add(pat);
+        }
+      }
+    }
+  }
+}
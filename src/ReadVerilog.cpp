@@ -0,0 +1,219 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+
+#include "VerilogReader.h"
+
+static std::string ReadFile(std::string const &filename) {
+  std::ifstream f(filename, std::ios::binary);
+  if(!f) {
+    throw std::runtime_error("cannot open " + filename);
+  }
+  std::stringstream ss;
+  ss << f.rdbuf();
+  return ss.str();
+}
+
+// width of the first "[msb:lsb]" at or after pos
+static int Width(std::string const &str, size_t pos) {
+  size_t begin = str.find('[', pos);
+  size_t end = str.find(':', begin);
+  if(begin == std::string::npos || end == std::string::npos) {
+    return 0;
+  }
+  return std::stoi(str.substr(begin + 1, end - begin - 1)) + 1;
+}
+
+// parses the case items "n'b<pattern>: <reg> = m'b<values>;" into one onset per output bit, lsb first
+static void ReadCase(std::string const &filename, int nInputs, std::vector<std::vector<int> > &onsets) {
+  std::string str = ReadFile(filename);
+  size_t pos = 0;
+  // skip up to the line starting with case
+  while(pos < str.size()) {
+    size_t begin = str.find_first_not_of(" \t", pos);
+    pos = str.find('\n', pos);
+    pos = pos == std::string::npos? str.size(): pos + 1;
+    if(begin != std::string::npos && str.compare(begin, 4, "case") == 0) {
+      break;
+    }
+  }
+  while(pos < str.size()) {
+    size_t end = str.find('\n', pos);
+    if(end == std::string::npos) {
+      end = str.size();
+    }
+    size_t colon = str.find(':', pos);
+    size_t b = str.find('b', pos);
+    if(colon >= end || b >= colon) {
+      // a blank line, default, or endcase ends the table
+      break;
+    }
+    int pat = 0;
+    int nBits = 0;
+    for(size_t i = b + 1; i < colon; i++) {
+      if(str[i] == '0' || str[i] == '1') {
+        pat = (pat << 1) | (str[i] - '0');
+        nBits++;
+      }
+    }
+    if(nBits != nInputs) {
+      throw std::runtime_error("wrong pattern width in " + filename);
+    }
+    size_t eq = str.find('=', colon);
+    size_t b2 = str.find('b', eq);
+    size_t semi = str.find(';', b2);
+    if(eq >= end || b2 >= end || semi > end) {
+      throw std::runtime_error("cannot parse " + filename);
+    }
+    int nOutputs = semi - b2 - 1;
+    if(onsets.empty()) {
+      onsets.resize(nOutputs);
+    }
+    if(nOutputs != (int)onsets.size()) {
+      throw std::runtime_error("wrong output width in " + filename);
+    }
+    for(int j = 0; j < nOutputs; j++) {
+      if(str[semi - 1 - j] == '1') {
+        onsets[j].push_back(pat);
+      }
+    }
+    pos = end + 1;
+  }
+  if(onsets.empty()) {
+    throw std::runtime_error("no case items in " + filename);
+  }
+}
+
+VerilogReader::VerilogReader(std::string const &dirname, std::string const &layerid, int nThreads, int nWindow): prefix(dirname + "/layer" + layerid), nWindow(nWindow), iNext(0), iClaim(0), nOutputsRead(0), fStop(false) {
+  modulename = "layer" + layerid;
+  ReadLayer(prefix + ".v");
+  vvvOnsets.resize(vvLUTInputs.size());
+  vReady.resize(vvLUTInputs.size());
+  vErrors.resize(vvLUTInputs.size());
+  for(int i = 0; i < std::max(nThreads, 1); i++) {
+    vThreads.emplace_back(&VerilogReader::Worker, this);
+  }
+}
+
+VerilogReader::~VerilogReader() {
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    fStop = true;
+  }
+  cv.notify_all();
+  for(auto &t: vThreads) {
+    t.join();
+  }
+}
+
+void VerilogReader::ReadLayer(std::string const &filename) {
+  std::string str = ReadFile(filename);
+  size_t eol = str.find('\n');
+  std::string header = str.substr(0, eol);
+  int nInputs = Width(header, 0);
+  int nOutputs = Width(header, header.find("output"));
+  for(int i = 0; i < nInputs; i++) {
+    inputs.push_back("M0[" + std::to_string(i) + "]");
+  }
+  for(int i = 0; i < nOutputs; i++) {
+    outputs.push_back("M1[" + std::to_string(i) + "]");
+  }
+  std::stringstream ss(str.substr(eol == std::string::npos? str.size(): eol + 1));
+  std::string line;
+  while(std::getline(ss, line)) {
+    std::stringstream ls(line);
+    std::string word;
+    ls >> word;
+    if(word == "endmodule") {
+      break;
+    }
+    if(word != "wire") {
+      continue;
+    }
+    size_t begin = line.find('{');
+    size_t end = line.find('}', begin);
+    if(begin == std::string::npos || end == std::string::npos) {
+      throw std::runtime_error("cannot parse " + line + " in " + filename);
+    }
+    std::vector<std::string> LUTInputs;
+    std::string input;
+    for(size_t i = begin + 1; i < end; i++) {
+      if(line[i] == ',') {
+        LUTInputs.push_back(input);
+        input.clear();
+      } else if(!isspace(line[i])) {
+        input += line[i];
+      }
+    }
+    LUTInputs.push_back(input);
+    vvLUTInputs.push_back(LUTInputs);
+  }
+}
+
+void VerilogReader::Worker() {
+  while(true) {
+    int k;
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      if(iClaim >= (int)vvLUTInputs.size()) {
+        return;
+      }
+      k = iClaim++;
+      // do not run too far ahead of the consumer
+      cv.wait(lock, [&]() { return fStop || k < iNext + nWindow; });
+      if(fStop) {
+        return;
+      }
+    }
+    std::vector<std::vector<int> > onsets;
+    std::exception_ptr error;
+    try {
+      ReadCase(prefix + "_N" + std::to_string(k) + ".v", vvLUTInputs[k].size(), onsets);
+    } catch(...) {
+      error = std::current_exception();
+    }
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      vvvOnsets[k].swap(onsets);
+      vErrors[k] = error;
+      vReady[k] = 1;
+    }
+    cv.notify_all();
+  }
+}
+
+int VerilogReader::ReadFuncs(std::vector<std::string> &LUTInputs, std::vector<std::string> &LUTOutputs, std::vector<std::vector<int> > &onsets) {
+  LUTInputs.clear();
+  LUTOutputs.clear();
+  onsets.clear();
+  if(iNext >= (int)vvLUTInputs.size()) {
+    return 0;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [&]() { return vReady[iNext]; });
+    if(vErrors[iNext]) {
+      std::rethrow_exception(vErrors[iNext]);
+    }
+    onsets.swap(vvvOnsets[iNext]);
+  }
+  LUTInputs = vvLUTInputs[iNext];
+  if(nOutputsRead + onsets.size() > outputs.size()) {
+    throw std::runtime_error("more LUT outputs than layer outputs in " + prefix + ".v");
+  }
+  for(unsigned j = 0; j < onsets.size(); j++) {
+    LUTOutputs.push_back(outputs[nOutputsRead++]);
+  }
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    iNext++;
+  }
+  cv.notify_all();
+  return 1;
+}
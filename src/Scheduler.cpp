@@ -0,0 +1,101 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <unordered_set>
+#include <cmath>
+#include <mutex>
+#include <chrono>
+#include <exception>
+
+#include "Params.h"
+#include "Group.h"
+#include "ThreadPool.h"
+#include "Context.h"
+
+extern void TTTest(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &vpBPats, int nBPats, PatternCounter const *pCount, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f, Params const &params, Context const &ctx);
+
+// predicted cost of a group in arbitrary units
+// a sifting round rebuilds the diagram O(nInputs^2) times, and each rebuild scans the whole table
+double PredictCost(Group const &group, int rarity, double &density, double &care) {
+  int nBPats = group.nBPats;
+  int nInputs = group.inputs.size();
+  int nOutputs = group.outputs.size();
+  double nPats = std::ldexp(1.0, nInputs);
+  double nOnes = 0;
+  for(auto const &onset: group.onsets) {
+    nOnes += onset.size();
+  }
+  density = nOnes / (nPats * nOutputs);
+  care = 1;
+  if(rarity && nBPats) {
+    // estimated from the first patterns only
+    std::unordered_set<int> pats;
+    for(int i = 0; i < std::min(nBPats, 4096); i++) {
+      for(int j = 0; j < 8; j++) {
+        int pat = 0;
+        for(auto pBPat: group.vpBPats) {
+          pat <<= 1;
+          pat |= (pBPat[i] >> j) & 1;
+        }
+        pats.insert(pat);
+      }
+    }
+    care = std::min(1.0, pats.size() / nPats);
+  } else if(rarity && group.pCount) {
+    double nSeen = 0;
+    group.pCount->ForEach([&](int pat, int n) {
+      nSeen++;
+    });
+    care = std::min(1.0, nSeen / nPats);
+  }
+  return nOutputs * nPats * nInputs * nInputs * (0.1 + 4 * density * (1 - density)) * (0.1 + care);
+}
+
+// optimizes the groups on the work-stealing pool of ctx, most expensive first, and writes them in the original order
+void RunGroups(std::vector<Group> const &groups, int rarity, std::ostream &f, Params const &params, Context const &ctx) {
+  int nGroups = groups.size();
+  std::vector<double> vPredicted(nGroups);
+  std::vector<double> vDensities(nGroups);
+  std::vector<double> vCares(nGroups);
+  for(int i = 0; i < nGroups; i++) {
+    vPredicted[i] = PredictCost(groups[i], rarity, vDensities[i], vCares[i]);
+  }
+  std::vector<int> vOrder(nGroups);
+  std::iota(vOrder.begin(), vOrder.end(), 0);
+  std::stable_sort(vOrder.begin(), vOrder.end(), [&](int i1, int i2) { return vPredicted[i1] > vPredicted[i2]; });
+  std::vector<std::string> vBlifs(nGroups);
+  std::mutex mtx;
+  ThreadPool &pool = *ctx.pPool;
+  std::atomic<int> nPending(0);
+  // errors of the groups are kept until all have finished, the first one in the original order is rethrown
+  std::vector<std::exception_ptr> vErrors(nGroups);
+  for(int i: vOrder) {
+    pool.Submit([&, i]() {
+      Group const &group = groups[i];
+      auto start = std::chrono::steady_clock::now();
+      std::stringstream ss;
+      try {
+        TTTest(group.onsets, group.vpBPats, group.nBPats, group.pCount, rarity, group.inputs, group.outputs, ss, params, ctx);
+      } catch(...) {
+        vErrors[i] = std::current_exception();
+        return;
+      }
+      vBlifs[i] = ss.str();
+      std::chrono::duration<double> actual = std::chrono::steady_clock::now() - start;
+      std::unique_lock<std::mutex> lock(mtx);
+      std::cout << "cost " << group.outputs.front() << " " << group.inputs.size() << " " << group.outputs.size() << " " << vDensities[i] << " " << vCares[i] << " " << vPredicted[i] << " " << actual.count() << std::endl;
+    }, nPending);
+  }
+  pool.Wait(nPending);
+  for(auto const &error: vErrors) {
+    if(error) {
+      std::rethrow_exception(error);
+    }
+  }
+  for(auto const &blif: vBlifs) {
+    f << blif;
+  }
+}
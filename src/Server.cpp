@@ -0,0 +1,125 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <cstring>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+// a request is the text the client writes before shutting down its side of the connection:
+//   a line "run" or "group", a line with the working directory of the client,
+//   one line per argument, an empty line, and for "group" the .names of the group up to the end
+// the reply is what the job printed to the standard output, as a line "out <length>" followed by that many bytes,
+// then what it printed to the standard error the same way after "err <length>", and a line "status <code>"
+typedef std::function<int(std::string const &kind, std::vector<std::string> const &args, std::string const &body, std::ostream &out)> ServerJob;
+
+static bool ReadAll(int fd, std::string &str) {
+  char buf[1 << 16];
+  while(true) {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if(n < 0) {
+      return false;
+    }
+    if(!n) {
+      return true;
+    }
+    str.append(buf, n);
+  }
+}
+
+static void WriteAll(int fd, std::string const &str) {
+  size_t pos = 0;
+  while(pos < str.size()) {
+    ssize_t n = write(fd, str.data() + pos, str.size() - pos);
+    if(n <= 0) {
+      // the client went away
+      return;
+    }
+    pos += n;
+  }
+}
+
+// serves one request at a time on the Unix socket sockname until the process is killed
+// jobs run in the directory of the client, and everything they print goes back to it
+// the server returns to its own directory after each, so that it does not hold on to that of a client
+int Serve(std::string sockname, ServerJob Job) {
+  signal(SIGPIPE, SIG_IGN);
+  int home = open(".", O_RDONLY | O_DIRECTORY);
+  if(home < 0) {
+    std::cerr << "cannot open the working directory" << std::endl;
+    return 1;
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  if(fd < 0 || sockname.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "cannot create socket " << sockname << std::endl;
+    return 1;
+  }
+  strcpy(addr.sun_path, sockname.c_str());
+  unlink(sockname.c_str());
+  if(bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, 64) < 0) {
+    std::cerr << "cannot listen on " << sockname << std::endl;
+    return 1;
+  }
+  std::cerr << "listening on " << sockname << std::endl;
+  while(true) {
+    int conn = accept(fd, NULL, NULL);
+    if(conn < 0) {
+      continue;
+    }
+    std::string request;
+    if(!ReadAll(conn, request)) {
+      close(conn);
+      continue;
+    }
+    std::stringstream ss(request);
+    std::string kind, cwd, arg;
+    std::getline(ss, kind);
+    std::getline(ss, cwd);
+    std::vector<std::string> args;
+    while(std::getline(ss, arg) && !arg.empty()) {
+      args.push_back(arg);
+    }
+    std::string body(request, std::min(request.size(), (size_t)ss.tellg()));
+    if(!ss) {
+      body.clear();
+    }
+    std::stringstream out, err;
+    int status = 1;
+    if((kind != "run" && kind != "group") || chdir(cwd.c_str()) < 0) {
+      err << "bad request" << std::endl;
+    } else {
+      // the streams are shared, so jobs are run one after another
+      std::streambuf *coutbuf = std::cout.rdbuf(out.rdbuf());
+      std::streambuf *cerrbuf = std::cerr.rdbuf(err.rdbuf());
+      // a failing job is reported to its client, the server goes on
+      try {
+        status = Job(kind, args, body, out);
+      } catch(std::exception const &e) {
+        err << e.what() << std::endl;
+        status = 1;
+      }
+      std::cout.rdbuf(coutbuf);
+      std::cerr.rdbuf(cerrbuf);
+    }
+    if(fchdir(home) < 0) {
+      std::cerr << "cannot return to the working directory" << std::endl;
+      return 1;
+    }
+    std::string reply;
+    for(auto const &stream: {std::make_pair("out", out.str()), std::make_pair("err", err.str())}) {
+      reply += stream.first + std::string(" ") + std::to_string(stream.second.size()) + "\n" + stream.second;
+    }
+    reply += "status " + std::to_string(status) + "\n";
+    WriteAll(conn, reply);
+    close(conn);
+  }
+  return 0;
+}
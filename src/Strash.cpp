@@ -0,0 +1,138 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+struct Names {
+  std::vector<std::string> fanins;
+  std::string output;
+  std::vector<std::string> cubes; // input parts of the rows
+  bool fOffset = false;
+};
+
+}
+
+// the function of a node of up to 6 fanins, bit m is its value when fanin j is bit (nFanins - 1 - j) of m
+static uint64_t NamesTable(Names const &node) {
+  int nFanins = node.fanins.size();
+  uint64_t table = 0;
+  for(int m = 0; m < (1 << nFanins); m++) {
+    for(auto const &cube: node.cubes) {
+      bool fMatch = true;
+      for(int j = 0; j < nFanins && fMatch; j++) {
+        int value = (m >> (nFanins - 1 - j)) & 1;
+        fMatch = cube[j] == '-' || cube[j] - '0' == value;
+      }
+      if(fMatch) {
+        table |= 1ull << m;
+        break;
+      }
+    }
+  }
+  if(node.fOffset) {
+    table ^= (nFanins == 6)? ~0ull: (1ull << (1 << nFanins)) - 1;
+  }
+  return table;
+}
+
+static void WriteNames(Names const &node, std::ostream &f) {
+  f << ".names";
+  for(auto const &fanin: node.fanins) {
+    f << " " << fanin;
+  }
+  f << " " << node.output << std::endl;
+  for(auto const &cube: node.cubes) {
+    if(!cube.empty()) {
+      f << cube << " ";
+    }
+    f << (node.fOffset? "0": "1") << std::endl;
+  }
+}
+
+// writes the .names of blif, given in topological order, merging the nodes that compute the same function of the same fanins
+// buffers are replaced by their fanin, except those driving an output of the layer, so the per-group constants and
+// input buffers disappear and the muxes of different groups over the same inputs are merged
+// nodes of up to 6 fanins are compared by truth table, larger ones by their sorted cubes
+// returns the number of nodes written, nNodes is set to the number read
+int StrashBlif(std::string const &blif, std::vector<std::string> const &outputs, std::ostream &f, int &nNodes) {
+  std::set<std::string> pos(outputs.begin(), outputs.end());
+  std::unordered_map<std::string, std::string> alias;
+  std::map<std::pair<std::vector<std::string>, std::string>, std::string> unique;
+  std::stringstream ss(blif);
+  std::string line;
+  std::vector<Names> nodes;
+  while(std::getline(ss, line)) {
+    std::stringstream ls(line);
+    std::string token;
+    if(!(ls >> token)) {
+      continue;
+    }
+    if(token == ".names") {
+      nodes.emplace_back();
+      while(ls >> token) {
+        nodes.back().fanins.push_back(token);
+      }
+      nodes.back().output = nodes.back().fanins.back();
+      nodes.back().fanins.pop_back();
+      continue;
+    }
+    if(token[0] != '0' && token[0] != '1' && token[0] != '-') {
+      continue;
+    }
+    Names &node = nodes.back();
+    std::string out;
+    if(node.fanins.empty()) {
+      out = token;
+      token.clear();
+    } else {
+      ls >> out;
+    }
+    node.fOffset = out == "0";
+    node.cubes.push_back(token);
+  }
+  nNodes = nodes.size();
+  int nWritten = 0;
+  for(auto &node: nodes) {
+    for(auto &fanin: node.fanins) {
+      auto it = alias.find(fanin);
+      if(it != alias.end()) {
+        fanin = it->second;
+      }
+    }
+    std::pair<std::vector<std::string>, std::string> key;
+    key.first = node.fanins;
+    if(node.fanins.size() <= 6) {
+      uint64_t table = NamesTable(node);
+      if(node.fanins.size() == 1 && table == 2 && !pos.count(node.output)) {
+        alias[node.output] = node.fanins[0];
+        continue;
+      }
+      key.second = std::to_string(table);
+    } else {
+      std::vector<std::string> cubes = node.cubes;
+      std::sort(cubes.begin(), cubes.end());
+      key.second = node.fOffset? "0": "1";
+      for(auto const &cube: cubes) {
+        key.second += " " + cube;
+      }
+    }
+    auto it = unique.find(key);
+    if(it != unique.end() && !pos.count(node.output)) {
+      alias[node.output] = it->second;
+      continue;
+    }
+    if(it == unique.end()) {
+      unique[key] = node.output;
+    }
+    WriteNames(node, f);
+    nWritten++;
+  }
+  return nWritten;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <chrono>
+
+// work-stealing pool: each worker owns a deque and steals from the others when its own is empty
+// a worker waiting for its subtasks keeps running tasks, so tasks may submit and wait for subtasks
+class ThreadPool {
+public:
+  ThreadPool(int nThreads): vQueues(nThreads) {
+    for(auto &q: vQueues) {
+      q.reset(new Queue);
+    }
+    for(int i = 0; i < nThreads; i++) {
+      vThreads.emplace_back([this, i]() {
+        iWorker() = i;
+        while(!fStop) {
+          if(!RunOne(i)) {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait_for(lock, std::chrono::milliseconds(10), [this]() { return fStop || nQueued > 0; });
+          }
+        }
+      });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      fStop = true;
+    }
+    cv.notify_all();
+    for(auto &th: vThreads) {
+      th.join();
+    }
+  }
+
+  int NumThreads() {
+    return vThreads.size();
+  }
+
+  // tasks from a worker go to the front of its own deque, others are dealt out round-robin
+  void Submit(std::function<void()> task, std::atomic<int> &nPending) {
+    nPending++;
+    int i = iWorker();
+    bool fFront = i >= 0;
+    if(i < 0) {
+      i = (nNext++) % vQueues.size();
+    }
+    {
+      std::unique_lock<std::mutex> lock(vQueues[i]->mtx);
+      auto wrapped = [task, &nPending, this]() {
+        task();
+        {
+          std::unique_lock<std::mutex> lock(mtx);
+          nPending--;
+        }
+        cvDone.notify_all();
+      };
+      if(fFront) {
+        vQueues[i]->tasks.push_front(wrapped);
+      } else {
+        vQueues[i]->tasks.push_back(wrapped);
+      }
+      nQueued++;
+    }
+    cv.notify_one();
+  }
+
+  // waits for nPending to drop to zero, running tasks meanwhile if called from a worker
+  void Wait(std::atomic<int> &nPending) {
+    int i = iWorker();
+    while(nPending > 0) {
+      if(i >= 0 && RunOne(i)) {
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mtx);
+      cvDone.wait_for(lock, std::chrono::milliseconds(i >= 0? 1: 100), [&nPending]() { return nPending == 0; });
+    }
+  }
+
+private:
+  struct Queue {
+    std::mutex mtx;
+    std::deque<std::function<void()> > tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue> > vQueues;
+  std::vector<std::thread> vThreads;
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::condition_variable cvDone;
+  std::atomic<int> nQueued{0};
+  std::atomic<int> nNext{0};
+  std::atomic<bool> fStop{false};
+
+  static int &iWorker() {
+    static thread_local int i = -1;
+    return i;
+  }
+
+  bool Pop(int i, std::function<void()> &task) {
+    std::unique_lock<std::mutex> lock(vQueues[i]->mtx);
+    if(vQueues[i]->tasks.empty()) {
+      return false;
+    }
+    task = std::move(vQueues[i]->tasks.front());
+    vQueues[i]->tasks.pop_front();
+    nQueued--;
+    return true;
+  }
+
+  bool RunOne(int self) {
+    std::function<void()> task;
+    int n = vQueues.size();
+    for(int k = 0; k < n; k++) {
+      if(Pop((self + k) % n, task)) {
+        task();
+        return true;
+      }
+    }
+    return false;
+  }
+};
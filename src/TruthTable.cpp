@@ -10,8 +10,56 @@
 #include <map>
 #include <bitset>
 #include <unordered_map>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <climits>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+
+#include "Params.h"
+#include "ThreadPool.h"
+#include "Context.h"
+#include "Cache.h"
+#include "OrderHints.h"
+#include "CareCache.h"
+#include "OrderDatabase.h"
+#include "Verify.h"
+#include "PatternCounter.h"
 
 extern std::string BinaryToString(int bin, int size);
+extern void VerifyGroup(std::string const &blif, std::vector<std::vector<int> > const &onsets, std::vector<char *> const &pBPats, int nBPats, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, ThreadPool *pPool, VerifyStats *pStats);
+
+// adds the occurrences of the patterns of up to 6 inputs to count, stopping early once all of them reach nCap
+// the minterm masks of 64 patterns are expanded one input at a time, the first input being the most significant bit
+#if defined(__x86_64__) || defined(__i386__)
+// popcnt is not in the baseline x86 ISA
+__attribute__((target_clones("popcnt", "default")))
+#endif
+static void CountSlices(std::vector<char *> const &pBPats, int nBPats, int nInputs, long long nCap, long long *count) {
+  uint64_t masks[64];
+  for(int i = 0; i < nBPats; i += 8) {
+    if(i % 1024 == 0 && i && *std::min_element(count, count + (1 << nInputs)) >= nCap) {
+      break;
+    }
+    int nBytes = std::min(8, nBPats - i);
+    masks[0] = nBytes == 8? ~0ull: (1ull << (8 * nBytes)) - 1;
+    for(int k = 0; k < nInputs; k++) {
+      uint64_t value = 0;
+      memcpy(&value, pBPats[k] + i, nBytes);
+      for(int m = (1 << k) - 1; m >= 0; m--) {
+        masks[2 * m + 1] = masks[m] & value;
+        masks[2 * m] = masks[m] & ~value;
+      }
+    }
+    for(int m = 0; m < (1 << nInputs); m++) {
+      count[m] += __builtin_popcountll(masks[m]);
+    }
+  }
+}
 
 template <class T>
 inline void hash_combine(std::size_t & seed, const T & v)
@@ -34,11 +82,20 @@ namespace std
   };
 }
 
+// empties the first nLevels levels of vv, keeping the capacity of those already allocated
+template <class T>
+inline void ClearLevels(std::vector<std::vector<T> > &vv, int nLevels) {
+  for(auto &v: vv) {
+    v.clear();
+  }
+  vv.resize(nLevels);
+}
+
 class TruthTable {
 public:
   typedef uint64_t word;
-  const int ww = 64; // word width
-  const int lww = 6; // log word width
+  static constexpr int ww = 64; // word width
+  static constexpr int lww = 6; // log word width
   typedef std::bitset<64> bsw;
 
   int nInputs;
@@ -57,15 +114,27 @@ public:
   std::vector<std::vector<int> > vLevelsSaved;
 
   std::mt19937 rng;
+  std::function<bool(int, int)> Stop; // called with (round, best) between rounds of RandomSiftReo, stops it if true
+  std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max(); // searches and Optimize give up after it
+  bool fCancelled = false;
   static const word ones[];
   static const word swapmask[];
 
-  TruthTable(std::vector<std::vector<int> > const &onsets, int nInputs): nInputs(nInputs) {
+  TruthTable(std::vector<std::vector<int> > const &onsets, int nInputs) {
+    Reset(onsets, nInputs);
+  }
+
+  virtual ~TruthTable() {}
+
+  // reinitializes the engine for another group as if it was constructed again, keeping the capacity of the vectors
+  // the engines of a class redefine it to reset their own state
+  void Reset(std::vector<std::vector<int> > const &onsets, int nInputs) {
+    this->nInputs = nInputs;
     nOutputs = onsets.size();
     if(nInputs >= lww) {
       nSize = 1 << (nInputs - lww);
       nTotalSize = nSize * nOutputs;
-      t.resize(nTotalSize);
+      t.assign(nTotalSize, 0);
       for(int i = 0; i < nOutputs; i++) {
         for(int pat: onsets[i]) {
           int index = pat / ww;
@@ -76,7 +145,7 @@ public:
     } else {
       nSize = 0;
       nTotalSize = ((1 << nInputs) * nOutputs + ww - 1) / ww;
-      t.resize(nTotalSize);
+      t.assign(nTotalSize, 0);
       for(int i = 0; i < nOutputs; i++) {
         int padding = i * (1 << nInputs);
         for(int pat: onsets[i]) {
@@ -87,6 +156,20 @@ public:
     }
     vLevels.resize(nInputs);
     std::iota(vLevels.begin(), vLevels.end(), 0);
+    ClearLevels(vvIndices, nInputs);
+    ClearLevels(vvRedundantIndices, nInputs);
+    rng.seed(std::mt19937::default_seed);
+    Stop = nullptr;
+    deadline = std::chrono::steady_clock::time_point::max();
+    fCancelled = false;
+  }
+
+  // checked between swaps and levels, stays true once the deadline has passed
+  bool Cancelled() {
+    if(!fCancelled && deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() > deadline) {
+      fCancelled = true;
+    }
+    return fCancelled;
   }
 
   void GeneratePla(std::string filename) {
@@ -259,10 +342,8 @@ public:
   }
 
   virtual void BDDBuildStartup() {
-    vvIndices.clear();
-    vvIndices.resize(nInputs);
-    vvRedundantIndices.clear();
-    vvRedundantIndices.resize(nInputs);
+    ClearLevels(vvIndices, nInputs);
+    ClearLevels(vvRedundantIndices, nInputs);
     for(int i = 0; i < nOutputs; i++) {
       BDDBuildOne(i, 0);
     }
@@ -278,18 +359,19 @@ public:
     }
   }
 
+  // a build cut short by the deadline returns INT_MAX, so that its partial count is never taken for the best
   virtual int BDDBuild() {
     BDDBuildStartup();
-    for(int i = 1; i < nInputs; i++) {
+    for(int i = 1; i < nInputs && !Cancelled(); i++) {
       BDDBuildLevel(i);
     }
-    return BDDNodeCount();
+    return fCancelled? INT_MAX: BDDNodeCount();
   }
 
   virtual int BDDRebuild(int lev) {
     vvIndices[lev].clear();
     vvIndices[lev+1].clear();
-    for(int i = lev; i < lev + 2; i++) {
+    for(int i = lev; i < lev + 2 && !Cancelled(); i++) {
       if(!i) {
         for(int j = 0; j < nOutputs; j++) {
           BDDBuildOne(j, 0);
@@ -299,6 +381,9 @@ public:
         BDDBuildLevel(i);
       }
     }
+    if(fCancelled) {
+      return INT_MAX;
+    }
     if(lev < nInputs - 2) {
       vvRedundantIndices[lev+1].clear();
       for(int index: vvIndices[lev+1]) {
@@ -369,7 +454,7 @@ public:
     for(int var: vars) {
       bool updated = false;
       int lev = vLevels[var];
-      for(int i = lev; i < nInputs - 1; i++) {
+      for(int i = lev; i < nInputs - 1 && !Cancelled(); i++) {
         int count = BDDSwap(i);
         if(best > count) {
           best = count;
@@ -381,7 +466,7 @@ public:
       if(lev) {
         Load(!turn);
         LoadIndices(!turn);
-        for(int i = lev - 1; i >= 0; i--) {
+        for(int i = lev - 1; i >= 0 && !Cancelled(); i--) {
           int count = BDDSwap(i);
           if(best > count) {
             best = count;
@@ -394,6 +479,9 @@ public:
       turn ^= updated;
       Load(!turn);
       LoadIndices(!turn);
+      if(fCancelled) {
+        break;
+      }
     }
     return best;
   }
@@ -415,25 +503,88 @@ public:
     assert(vLevels == vLevelsNew);
   }
 
-  int RandomSiftReo(int nRound) {
-    int best = SiftReo();
+  // Sift replaces SiftReo in the rounds if given, for a sifting of the same result run differently
+  int RandomSiftReo(int nRound, std::function<int()> const &Sift = nullptr) {
+    int best = Sift? Sift(): SiftReo();
     Save(2);
+    SaveIndices(2);
     for(int i = 0; i < nRound; i++) {
+      if((Stop && Stop(i, best)) || Cancelled()) {
+        break;
+      }
       std::vector<int> vLevelsNew(nInputs);
       std::iota(vLevelsNew.begin(), vLevelsNew.end(), 0);
       std::shuffle(vLevelsNew.begin(), vLevelsNew.end(), rng);
       Reo(vLevelsNew);
-      int r = SiftReo();
+      int r = Sift? Sift(): SiftReo();
       if(best > r) {
         best = r;
         Save(2);
+        SaveIndices(2);
+      }
+    }
+    Load(2);
+    LoadIndices(2);
+    return best;
+  }
+
+  // visits all orders by one adjacent swap each (Steinhaus-Johnson-Trotter), calling Visit(lev) after swapping lev and lev+1
+  // stops early if Visit returns false
+  template <class F>
+  void ForEachOrder(F Visit) {
+    // vPos holds the variables by level, vDirs their directions
+    std::vector<int> vPos(nInputs), vDirs(nInputs, -1);
+    std::iota(vPos.begin(), vPos.end(), 0);
+    while(true) {
+      int mobile = -1;
+      for(int i = 0; i < nInputs; i++) {
+        int j = i + vDirs[vPos[i]];
+        if(j >= 0 && j < nInputs && vPos[i] > vPos[j] && (mobile < 0 || vPos[i] > vPos[mobile])) {
+          mobile = i;
+        }
+      }
+      if(mobile < 0) {
+        break;
+      }
+      int var = vPos[mobile];
+      int j = mobile + vDirs[var];
+      std::swap(vPos[mobile], vPos[j]);
+      if(!Visit(std::min(mobile, j))) {
+        break;
       }
+      for(int i = 0; i < nInputs; i++) {
+        if(vPos[i] > var) {
+          vDirs[vPos[i]] = -vDirs[vPos[i]];
+        }
+      }
+    }
+  }
+
+  // tries all orders and keeps the first smallest
+  // only meant for tiny groups, where the nInputs! swaps are fewer than the rebuilds of RandomSiftReo
+  int ExhaustiveReo() {
+    int best = BDDBuild();
+    Save(2);
+    SaveIndices(2);
+    if(!Cancelled()) {
+      ForEachOrder([&](int lev) {
+        int count = BDDSwap(lev);
+        if(best > count) {
+          best = count;
+          Save(2);
+          SaveIndices(2);
+        }
+        return !Cancelled();
+      });
     }
     Load(2);
+    LoadIndices(2);
     return best;
   }
 
-  int BDDGenerateBlifRec(std::vector<std::vector<int> > &vvNodes, int &nNodes, int index, int lev, std::ofstream &f, std::string const &prefix) {
+  virtual void Optimize() {}
+
+  int BDDGenerateBlifRec(std::vector<std::vector<int> > &vvNodes, int &nNodes, int index, int lev, std::ostream &f, std::string const &prefix) {
     int r = BDDFind(index, lev);
     if(r >= 0) {
       return (vvNodes[lev][r >> 1] << 1) ^ (r & 1);
@@ -454,11 +605,10 @@ public:
     return (nNodes++) << 1;
   }
 
-  virtual void BDDGenerateBlif(std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ofstream &f) {
+  virtual int BDDGenerateBlif(std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f) {
     std::string prefix = outputs.front();
     int nNodes = 1; // const node
-    vvIndices.clear();
-    vvIndices.resize(nInputs);
+    ClearLevels(vvIndices, nInputs);
     std::vector<std::vector<int> > vvNodes(nInputs);
     std::vector<int> vOutputs;
     f << ".names " << prefix << "n0" << std::endl;
@@ -471,6 +621,7 @@ public:
       f << ".names " << prefix << "n" << (node >> 1) << " " << outputs[i] << std::endl;
       f << !(node & 1) << " 1" << std::endl;
     }
+    return nNodes;
   }
 };
 
@@ -492,10 +643,16 @@ class TruthTableReo : public TruthTable {
 public:
   bool fBuilt = false;
   std::vector<std::vector<int> > vvChildren;
+  std::vector<int> vOutputs;
   std::vector<std::vector<std::vector<int> > > vvChildrenSaved;
 
   TruthTableReo(std::vector<std::vector<int> > const &onsets, int nInputs): TruthTable(onsets, nInputs) {}
 
+  void Reset(std::vector<std::vector<int> > const &onsets, int nInputs) {
+    TruthTable::Reset(onsets, nInputs);
+    fBuilt = false;
+  }
+
   void Save(uint i) override {
     if(vLevelsSaved.size() < i + 1) {
       vLevelsSaved.resize(i + 1);
@@ -522,9 +679,12 @@ public:
   }
 
   void BDDBuildStartup() override {
-    vvChildren.clear();
-    vvChildren.resize(nInputs);
+    ClearLevels(vvChildren, nInputs);
     TruthTable::BDDBuildStartup();
+    vOutputs.clear();
+    for(int i = 0; i < nOutputs; i++) {
+      vOutputs.push_back(BDDFind(i, 0));
+    }
   }
 
   void BDDBuildLevel(int lev) override {
@@ -539,16 +699,124 @@ public:
     }
   }
 
+  // a build cut short by the deadline is started over by the next one, and the swaps meanwhile only change the order
   int BDDBuild() override {
     if(fBuilt) {
       return BDDNodeCount();
     }
-    fBuilt = true;
-    BDDBuildStartup();
-    for(int i = 1; i < nInputs + 1; i++) {
-      BDDBuildLevel(i);
+    BDDBuildBottomUp();
+    fBuilt = !fCancelled;
+    return fBuilt? BDDNodeCount(): INT_MAX;
+  }
+
+  int BDDBuildWord(word value, int lev, std::vector<std::unordered_map<word, int> > &vWordIds, std::vector<std::vector<int> > &vvRawChildren) {
+    int logwidth = nInputs - lev;
+    if(!value) {
+      return -2;
+    }
+    if(value == ones[logwidth]) {
+      return -1;
+    }
+    bool fCompl = value & 1;
+    if(fCompl) {
+      value ^= ones[logwidth];
+    }
+    auto it = vWordIds[lev].find(value);
+    if(it != vWordIds[lev].end()) {
+      return (it->second << 1) ^ fCompl;
+    }
+    int cof0 = BDDBuildWord(value & ones[logwidth - 1], lev + 1, vWordIds, vvRawChildren);
+    int cof1 = BDDBuildWord(value >> (1 << (logwidth - 1)), lev + 1, vWordIds, vvRawChildren);
+    int id = vvRawChildren[lev].size() / 2;
+    vvRawChildren[lev].push_back(cof0);
+    vvRawChildren[lev].push_back(cof1);
+    vWordIds[lev][value] = id;
+    return (id << 1) ^ fCompl;
+  }
+
+  // builds the same vvIndices/vvChildren as BDDBuildStartup and BDDBuildLevel, but from the bottom
+  // cofactors that fit in a word are hashed by value, the others by their pair of children
+  void BDDBuildBottomUp() {
+    int lev0 = std::max(0, nInputs - lww);
+    std::vector<std::unordered_map<word, int> > vWordIds(nInputs);
+    std::vector<std::vector<int> > vvRawChildren(nInputs);
+    std::vector<int> vLits(nOutputs << lev0);
+    for(uint i = 0; i < vLits.size(); i++) {
+      vLits[i] = BDDBuildWord(GetValue(i, lev0), lev0, vWordIds, vvRawChildren);
+    }
+    for(int lev = lev0 - 1; lev >= 0 && !Cancelled(); lev--) {
+      std::vector<int> vLitsHigh(nOutputs << lev);
+      std::unordered_map<std::pair<int, int>, int> unique;
+      unique.reserve(vLitsHigh.size());
+      for(uint i = 0; i < vLitsHigh.size(); i++) {
+        int cof0 = vLits[i+i];
+        int cof1 = vLits[i+i+1];
+        if(cof0 < 0 && cof0 == cof1) {
+          vLitsHigh[i] = cof0;
+          continue;
+        }
+        bool fCompl = cof0 & 1;
+        cof0 ^= fCompl;
+        cof1 ^= fCompl;
+        auto it = unique.find({cof0, cof1});
+        if(it != unique.end()) {
+          vLitsHigh[i] = (it->second << 1) ^ fCompl;
+          continue;
+        }
+        int id = vvRawChildren[lev].size() / 2;
+        vvRawChildren[lev].push_back(cof0);
+        vvRawChildren[lev].push_back(cof1);
+        unique[{cof0, cof1}] = id;
+        vLitsHigh[i] = (id << 1) ^ fCompl;
+      }
+      vLits.swap(vLitsHigh);
+    }
+    if(fCancelled) {
+      return;
+    }
+    // renumber in the order of the top-down construction
+    // a node takes the polarity of the first cofactor that reaches it
+    ClearLevels(vvIndices, nInputs);
+    ClearLevels(vvRedundantIndices, nInputs);
+    ClearLevels(vvChildren, nInputs);
+    std::vector<std::vector<int> > vvNewLits(nInputs);
+    std::vector<std::vector<int> > vvRawLits(nInputs);
+    for(int i = 0; i < nInputs; i++) {
+      vvNewLits[i].resize(vvRawChildren[i].size() / 2, -1);
+    }
+    auto Renumber = [&](int lit, int index, int lev) {
+      if(lit < 0) {
+        return lit;
+      }
+      int &r = vvNewLits[lev][lit >> 1];
+      if(r < 0) {
+        r = (vvIndices[lev].size() << 1) ^ (lit & 1);
+        vvIndices[lev].push_back(index);
+        vvRawLits[lev].push_back(lit);
+      }
+      return r ^ (lit & 1);
+    };
+    vOutputs.clear();
+    for(int i = 0; i < nOutputs; i++) {
+      vOutputs.push_back(Renumber(vLits[i], i, 0));
+    }
+    for(int lev = 0; lev < nInputs; lev++) {
+      for(uint j = 0; j < vvIndices[lev].size(); j++) {
+        int index = vvIndices[lev][j];
+        int lit = vvRawLits[lev][j];
+        int cof0 = vvRawChildren[lev][(lit >> 1) << 1] ^ (lit & 1);
+        int cof1 = vvRawChildren[lev][((lit >> 1) << 1) ^ 1] ^ (lit & 1);
+        if(lev + 1 < nInputs) {
+          cof0 = Renumber(cof0, index << 1, lev + 1);
+          cof1 = Renumber(cof1, (index << 1) ^ 1, lev + 1);
+        }
+        vvChildren[lev].push_back(cof0);
+        vvChildren[lev].push_back(cof1);
+        if(cof0 == cof1) {
+          vvRedundantIndices[lev].push_back(index);
+        }
+      }
     }
-    return BDDNodeCount();
   }
 
   int BDDRebuildOne(int index, int cof0, int cof1, int lev, std::unordered_map<std::pair<int, int>, int> &unique, std::vector<int> &vChildrenLow) {
@@ -617,32 +885,108 @@ public:
 
   void Swap(int lev) override {
     assert(lev < nInputs - 1);
+    BDDBuild();
     auto it0 = std::find(vLevels.begin(), vLevels.end(), lev);
     auto it1 = std::find(vLevels.begin(), vLevels.end(), lev + 1);
     std::swap(*it0, *it1);
-    BDDRebuild(lev);
+    if(fBuilt) {
+      BDDRebuild(lev);
+    }
   }
 
   int BDDSwap(int lev) override {
     Swap(lev);
-    return BDDNodeCount();
+    return fBuilt? BDDNodeCount(): INT_MAX;
+  }
+
+  int BDDNodeLit(std::vector<std::vector<int> > const &vvNodes, int lit, int lev) {
+    if(lit < 0) {
+      return lit + 2;
+    }
+    return vvNodes[lev][lit >> 1] ^ (lit & 1);
   }
 
-  void BDDGenerateBlif(std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ofstream &f) override {
-    abort();
+  int BDDGenerateBlif(std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f) override {
+    BDDBuild();
+    std::string prefix = outputs.front();
+    int nNodes = 1; // const node
+    std::vector<std::vector<int> > vvNodes(nInputs);
+    f << ".names " << prefix << "n0" << std::endl;
+    for(int i = 0; i < nInputs; i++) {
+      f << ".names " << inputs[i] << " " << prefix << "v" << vLevels[i] << std::endl;
+      f << "1 1" << std::endl;
+    }
+    for(int lev = nInputs - 1; lev >= 0; lev--) {
+      for(uint j = 0; j < vvIndices[lev].size(); j++) {
+        int cof0 = BDDNodeLit(vvNodes, vvChildren[lev][j+j], lev + 1);
+        int cof1 = BDDNodeLit(vvNodes, vvChildren[lev][j+j+1], lev + 1);
+        if(cof0 == cof1) {
+          vvNodes[lev].push_back(cof0);
+          continue;
+        }
+        f << ".names " << prefix << "v" << lev << " " << prefix << "n" << (cof0 >> 1) << " " << prefix << "n" << (cof1 >> 1) << " " << prefix << "n" << nNodes << std::endl;
+        f << "0" << !(cof0 & 1) << "- 1" << std::endl;
+        f << "1-" << !(cof1 & 1) << " 1" << std::endl;
+        vvNodes[lev].push_back((nNodes++) << 1);
+      }
+    }
+    for(int i = 0; i < nOutputs; i++) {
+      int node = BDDNodeLit(vvNodes, vOutputs[i], 0);
+      f << ".names " << prefix << "n" << (node >> 1) << " " << outputs[i] << std::endl;
+      f << !(node & 1) << " 1" << std::endl;
+    }
+    return nNodes;
   }
 };
 
 class TruthTableRewrite : public TruthTable {
 public:
+  bool fJournal = false;
+  int nJournalEpoch = 0;
+  std::vector<std::pair<int, word> > vJournal;
+  std::vector<int> vJournalEpochs;
+
   TruthTableRewrite(std::vector<std::vector<int> > const &onsets, int nInputs): TruthTable(onsets, nInputs) {}
 
+  void Reset(std::vector<std::vector<int> > const &onsets, int nInputs) {
+    TruthTable::Reset(onsets, nInputs);
+    fJournal = false;
+  }
+
+  // undo log of overwritten words of t, replayed backwards by Rollback
+  void StartJournal() {
+    vJournal.clear();
+    if(vJournalEpochs.size() != t.size()) {
+      vJournalEpochs.clear();
+      vJournalEpochs.resize(t.size());
+      nJournalEpoch = 0;
+    }
+    nJournalEpoch++;
+    fJournal = true;
+  }
+
+  void Record(int index) {
+    if(fJournal && vJournalEpochs[index] != nJournalEpoch) {
+      vJournalEpochs[index] = nJournalEpoch;
+      vJournal.push_back({index, t[index]});
+    }
+  }
+
+  void Rollback() {
+    for(auto it = vJournal.rbegin(); it != vJournal.rend(); it++) {
+      t[(*it).first] = (*it).second;
+    }
+    vJournal.clear();
+    fJournal = false;
+  }
+
   void SetValue(int index_lev, int lev, word value) {
     assert(index_lev >= 0);
     assert(nInputs - lev <= lww);
     int logwidth = nInputs - lev;
     int index = index_lev >> (lww - logwidth);
     int pos = (index_lev % (1 << (lww - logwidth))) << logwidth;
+    Record(index);
     t[index] &= ~(ones[logwidth] << pos);
     t[index] ^= value << pos;
   }
@@ -652,6 +996,9 @@ public:
     int logwidth = nInputs - lev;
     if(logwidth > lww) {
       int nScopeSize = 1 << (logwidth - lww);
+      for(int i = 0; i < nScopeSize; i++) {
+        Record(nScopeSize * index1 + i);
+      }
       if(!fCompl) {
         if(index2 < 0) {
           for(int i = 0; i < nScopeSize; i++) {
@@ -706,6 +1053,7 @@ class TruthTableCare : public TruthTableRewrite {
 public:
   std::vector<word> originalt;
   std::vector<word> caret;
+  std::vector<word> careocc; // bit i is set if caret[i] is not zero
   std::vector<word> care;
 
   std::vector<std::vector<std::pair<int, int> > > vvMergedIndices;
@@ -713,13 +1061,54 @@ public:
   std::vector<std::vector<word> > savedcare;
   std::vector<std::vector<std::vector<std::pair<int, int> > > > vvMergedIndicesSaved;
 
+  // shared by all instances when set, the same inputs are often loaded by several engines
+  static CareCache *pCareCache;
+
   TruthTableCare(std::vector<std::vector<int> > const &onsets, int nInputs, std::vector<char *> const &pBPats, int nBPats, int rarity): TruthTableRewrite(onsets, nInputs) {
-    if(nSize) {
-      care.resize(nSize);
+    SetCare(pBPats, nBPats, rarity);
+  }
+
+  void Reset(std::vector<std::vector<int> > const &onsets, int nInputs, std::vector<char *> const &pBPats, int nBPats, int rarity) {
+    TruthTableRewrite::Reset(onsets, nInputs);
+    SetCare(pBPats, nBPats, rarity);
+  }
+
+  void SetCare(std::vector<char *> const &pBPats, int nBPats, int rarity) {
+    if(pCareCache && nBPats) {
+      care = *pCareCache->Get(pBPats, nBPats, rarity, [&]() { return ComputeCare(pBPats, nBPats, rarity); });
     } else {
-      care.resize(1);
+      care = ComputeCare(pBPats, nBPats, rarity);
+    }
+  }
+
+  // from the counts of a streamed sim, whose patterns are not kept
+  void SetCare(PatternCounter const &count, int rarity) {
+    care = CareFromCounts(count, rarity);
+  }
+
+  std::vector<word> ComputeCare(std::vector<char *> const &pBPats, int nBPats, int rarity) {
+    if(nInputs <= 5 && rarity) {
+      return CareFromSlices(pBPats, nBPats, rarity);
+    }
+    return CareFromCounts(CountPatterns(pBPats, nBPats, rarity), rarity);
+  }
+
+  // for tiny groups, counts 64 patterns at a time as the popcounts of the minterm masks of the input words
+  std::vector<word> CareFromSlices(std::vector<char *> const &pBPats, int nBPats, int rarity) {
+    std::vector<long long> count(1 << nInputs);
+    CountSlices(pBPats, nBPats, nInputs, rarity, count.data());
+    std::vector<word> care(1);
+    for(int m = 0; m < (1 << nInputs); m++) {
+      if(count[m] >= rarity) {
+        care[0] |= 1ull << m;
+      }
     }
-    std::vector<int> count(1 << nInputs);
+    return care;
+  }
+
+  // occurrences of each input pattern, counted up to nCap
+  PatternCounter CountPatterns(std::vector<char *> const &pBPats, int nBPats, int nCap) {
+    PatternCounter count(nInputs, 8ll * nBPats, nCap);
     for(int i = 0; i < nBPats; i++) {
       for(int j = 0; j < 8; j++) {
         int pat = 0;
@@ -727,14 +1116,31 @@ public:
           pat <<= 1;
           pat |= (pBPat[i] >> j) & 1;
         }
-        count[pat]++;
-        if(count[pat] == rarity) {
-          int index = pat / ww;
-          int pos = pat % ww;
-          care[index] |= 1ull << pos;
-        }
+        count.Add(pat);
       }
     }
+    return count;
+  }
+
+  // patterns seen at least rarity times, none if rarity is 0
+  std::vector<word> CareFromCounts(PatternCounter const &count, int rarity) {
+    std::vector<word> care;
+    if(nSize) {
+      care.resize(nSize);
+    } else {
+      care.resize(1);
+    }
+    if(!rarity) {
+      return care;
+    }
+    count.ForEach([&](int pat, int n) {
+      if(n >= rarity) {
+        int index = pat / ww;
+        int pos = pat % ww;
+        care[index] |= 1ull << pos;
+      }
+    });
+    return care;
   }
 
   void Save(uint i) override {
@@ -846,6 +1252,34 @@ public:
     }
   }
 
+  // the tables and the care set in the order where they are the smallest, the same for all groups equal up to
+  // a permutation of their inputs, with that order in vLevelsCanon
+  // walks all orders with table swaps only, so it is meant for groups of a few inputs
+  std::string CanonicalKey(std::vector<int> &vLevelsCanon) {
+    std::vector<int> vLevelsOld = vLevels;
+    std::vector<word> best, cur;
+    auto Visit = [&]() {
+      cur.assign(t.begin(), t.end());
+      cur.insert(cur.end(), care.begin(), care.end());
+      if(best.empty() || cur < best) {
+        best.swap(cur);
+        vLevelsCanon = vLevels;
+      }
+      return true;
+    };
+    Visit();
+    ForEachOrder([&](int lev) {
+      Swap(lev);
+      return Visit();
+    });
+    Reo(vLevelsOld);
+    std::string key(2 * sizeof(int) + best.size() * sizeof(word), 0);
+    memcpy(&key[0], &nInputs, sizeof(int));
+    memcpy(&key[sizeof(int)], &nOutputs, sizeof(int));
+    memcpy(&key[2 * sizeof(int)], best.data(), best.size() * sizeof(word));
+    return key;
+  }
+
   void RestoreCare() {
     caret.clear();
     if(nSize) {
@@ -859,6 +1293,12 @@ public:
         caret[padding / ww] |= care[0] << (padding % ww);
       }
     }
+    careocc.assign((caret.size() + ww - 1) / ww, 0);
+    for(int i = 0; i < (int)caret.size(); i++) {
+      if(caret[i]) {
+        careocc[i / ww] |= 1ull << (i % ww);
+      }
+    }
   }
 
   word GetCare(int index_lev, int lev) {
@@ -882,6 +1322,10 @@ public:
           value = ~value;
         }
         word cvalue = caret[nScopeSize * index2 + i];
+        if(!cvalue) {
+          continue;
+        }
+        Record(nScopeSize * index1 + i);
         t[nScopeSize * index1 + i] &= ~cvalue;
         t[nScopeSize * index1 + i] |= cvalue & value;
       }
@@ -901,11 +1345,17 @@ public:
 
   bool IsDC(int index, int lev) {
     if(nInputs - lev > lww) {
+      // tests the occupancy of the words instead of the words themselves
       int nScopeSize = 1 << (nInputs - lev - lww);
-      for(int i = 0; i < nScopeSize; i++) {
-        if(caret[nScopeSize * index + i]) {
-          return false;
+      int begin = nScopeSize * index;
+      if(nScopeSize >= ww) {
+        for(int i = begin / ww; i < (begin + nScopeSize) / ww; i++) {
+          if(careocc[i]) {
+            return false;
+          }
         }
+      } else if((careocc[begin / ww] >> (begin % ww)) & ones[nInputs - lev - lww]) {
+        return false;
       }
     } else if(GetCare(index, lev)) {
       return false;
@@ -969,13 +1419,20 @@ public:
     if(logwidth > lww) {
       int nScopeSize = 1 << (logwidth - lww);
       for(int i = 0; i < nScopeSize; i++) {
-        caret[nScopeSize * index1 + i] |= caret[nScopeSize * index2 + i];
+        int index = nScopeSize * index1 + i;
+        caret[index] |= caret[nScopeSize * index2 + i];
+        if(caret[index]) {
+          careocc[index / ww] |= 1ull << (index % ww);
+        }
       }
     } else {
       word value = GetCare(index2, lev);
       int index = index1 >> (lww - logwidth);
       int pos = (index1 % (1 << (lww - logwidth))) << logwidth;
       caret[index] |= value << pos;
+      if(caret[index]) {
+        careocc[index / ww] |= 1ull << (index % ww);
+      }
     }
   }
 
@@ -1006,12 +1463,9 @@ public:
 
   void BDDBuildStartup() override {
     RestoreCare();
-    vvIndices.clear();
-    vvIndices.resize(nInputs);
-    vvRedundantIndices.clear();
-    vvRedundantIndices.resize(nInputs);
-    vvMergedIndices.clear();
-    vvMergedIndices.resize(nInputs);
+    ClearLevels(vvIndices, nInputs);
+    ClearLevels(vvRedundantIndices, nInputs);
+    ClearLevels(vvMergedIndices, nInputs);
     for(int i = 0; i < nOutputs; i++) {
       if(!IsDC(i, 0)) {
         BDDBuildOne(i, 0);
@@ -1037,7 +1491,7 @@ public:
     for(int i = 0; i < lev; i++) {
       BDDRebuildByMerge(i);
     }
-    for(int i = lev; i < nInputs; i++) {
+    for(int i = lev; i < nInputs && !Cancelled(); i++) {
       if(!i) {
         for(int j = 0; j < nOutputs; j++) {
           if(!IsDC(j, 0)) {
@@ -1048,7 +1502,7 @@ public:
         BDDBuildLevel(i);
       }
     }
-    return BDDNodeCount();
+    return fCancelled? INT_MAX: BDDNodeCount();
   }
 
   int BDDSwap(int lev) override {
@@ -1059,10 +1513,8 @@ public:
   void OptimizationStartup() {
     originalt = t;
     RestoreCare();
-    vvIndices.clear();
-    vvIndices.resize(nInputs);
-    vvMergedIndices.clear();
-    vvMergedIndices.resize(nInputs);
+    ClearLevels(vvIndices, nInputs);
+    ClearLevels(vvMergedIndices, nInputs);
     for(int i = 0; i < nOutputs; i++) {
       if(!IsDC(i, 0)) {
         BDDBuildOne(i, 0);
@@ -1072,10 +1524,13 @@ public:
     }
   }
 
-  virtual void Optimize() {
+  void Optimize() override {
     OptimizationStartup();
     for(int i = 1; i < nInputs; i++) {
       for(int index: vvIndices[i-1]) {
+        if(Cancelled()) {
+          return;
+        }
         BDDBuildOne(index << 1, i);
         BDDBuildOne((index << 1) ^ 1, i);
       }
@@ -1084,6 +1539,8 @@ public:
   }
 };
 
+CareCache *TruthTableCare::pCareCache = NULL;
+
 class TruthTableCareReduce : public TruthTableCare {
 public:
   std::vector<std::vector<int> > vvChildren;
@@ -1112,10 +1569,8 @@ public:
   }
 
   void BDDBuildStartup() override {
-    vvChildren.clear();
-    vvChildren.resize(nInputs);
-    vvSkippedIndices.clear();
-    vvSkippedIndices.resize(nInputs);
+    ClearLevels(vvChildren, nInputs);
+    ClearLevels(vvSkippedIndices, nInputs);
     vvSkippedIndices[nInputs-1].push_back(empty);
     TruthTableCare::BDDBuildStartup();
   }
@@ -1131,9 +1586,13 @@ public:
 
   int BDDBuild() override {
     BDDBuildStartup();
-    for(int i = 1; i < nInputs; i++) {
+    for(int i = 1; i < nInputs && !Cancelled(); i++) {
       BDDBuildLevel(i);
     }
+    // the reduction needs every level
+    if(fCancelled) {
+      return INT_MAX;
+    }
     BDDReduce(nInputs - 2);
     return BDDNodeCount();
   }
@@ -1144,7 +1603,9 @@ public:
         vvChildren[i-1].clear();
       }
     }
-    TruthTableCare::BDDRebuild(lev);
+    if(TruthTableCare::BDDRebuild(lev) == INT_MAX) {
+      return INT_MAX;
+    }
     BDDReduce(nInputs - 2);
     return BDDNodeCount();
   }
@@ -1266,7 +1727,7 @@ public:
     for(int i = 0; i < lev; i++) {
       BDDRebuildByMerge(i);
     }
-    for(int i = lev; i < lev + 2; i++) {
+    for(int i = lev; i < lev + 2 && !Cancelled(); i++) {
       if(!i) {
         for(int j = 0; j < nOutputs; j++) {
           if(!IsDC(j, 0)) {
@@ -1277,6 +1738,9 @@ public:
         BDDBuildLevel(i);
       }
     }
+    if(fCancelled) {
+      return INT_MAX;
+    }
     if(lev < nInputs - 2) {
       vvMergedIndices[lev+2].clear();
       vvChildren[lev+1].clear();
@@ -1302,6 +1766,9 @@ public:
     OptimizationStartup();
     for(int i = 1; i < nInputs; i++) {
       for(int index: vvIndices[i-1]) {
+        if(Cancelled()) {
+          return;
+        }
         int cof0index = index << 1;
         int cof1index = cof0index ^ 1;
         if(IsDC(cof0index, i)) {
@@ -1326,6 +1793,11 @@ public:
 
   TruthTableOSM(std::vector<std::vector<int> > const &onsets, int nInputs, std::vector<char *> const &pBPats, int nBPats, int rarity, bool fComplOSM = true): TruthTableCareReduce(onsets, nInputs, pBPats, nBPats, rarity), fComplOSM(fComplOSM) {}
 
+  void Reset(std::vector<std::vector<int> > const &onsets, int nInputs, std::vector<char *> const &pBPats, int nBPats, int rarity, bool fComplOSM = true) {
+    TruthTableCareReduce::Reset(onsets, nInputs, pBPats, nBPats, rarity);
+    this->fComplOSM = fComplOSM;
+  }
+
   void BDDBuildLevel(int lev) override {
     for(int index: vvIndices[lev-1]) {
       int cof0index = index << 1;
@@ -1350,6 +1822,9 @@ public:
     OptimizationStartup();
     for(int i = 1; i < nInputs; i++) {
       for(int index: vvIndices[i-1]) {
+        if(Cancelled()) {
+          return;
+        }
         int cof0index = index << 1;
         int cof1index = cof0index ^ 1;
         if(int r = Include(cof0index, cof1index, i, fComplOSM)) {
@@ -1374,6 +1849,11 @@ public:
 
   TruthTableTSM(std::vector<std::vector<int> > const &onsets, int nInputs, std::vector<char *> const &pBPats, int nBPats, int rarity, bool fComplTSM = true): TruthTableCareReduce(onsets, nInputs, pBPats, nBPats, rarity), fComplTSM(fComplTSM) {}
 
+  void Reset(std::vector<std::vector<int> > const &onsets, int nInputs, std::vector<char *> const &pBPats, int nBPats, int rarity, bool fComplTSM = true) {
+    TruthTableCareReduce::Reset(onsets, nInputs, pBPats, nBPats, rarity);
+    this->fComplTSM = fComplTSM;
+  }
+
   void BDDBuildLevel(int lev) override {
     for(int index: vvIndices[lev-1]) {
       int cof0index = index << 1;
@@ -1394,9 +1874,9 @@ public:
   }
 
   int BDDBuild() override {
-    TruthTable::Save(3);
+    StartJournal();
     int r = TruthTableCareReduce::BDDBuild();
-    TruthTable::Load(3);
+    Rollback();
     return r;
   }
 
@@ -1408,9 +1888,9 @@ public:
   }
 
   int BDDRebuild(int lev) override {
-    TruthTable::Save(3);
+    StartJournal();
     int r = TruthTableCareReduce::BDDRebuild(lev);
-    TruthTable::Load(3);
+    Rollback();
     return r;
   }
 
@@ -1418,6 +1898,9 @@ public:
     OptimizationStartup();
     for(int i = 1; i < nInputs; i++) {
       for(int index: vvIndices[i-1]) {
+        if(Cancelled()) {
+          return;
+        }
         int cof0index = index << 1;
         int cof1index = cof0index ^ 1;
         if(int r = Intersect(cof0index, cof1index, i, fComplTSM)) {
@@ -1436,12 +1919,71 @@ public:
 
 class TruthTableLevelTSM : public TruthTableCare {
 public:
+  // per-node signatures aligned with vvIndices, used to skip candidates in BDDFindTSM
+  // narrow levels: {value, care}
+  // wide levels: {care occupancy of blocks, {value, care} of sampled words}
+  static constexpr int nSigSamples = 4;
+  std::vector<std::vector<word> > vvSigs;
+  std::vector<word> vSig;
+  int nFound;
+
   TruthTableLevelTSM(std::vector<std::vector<int> > const &onsets, int nInputs, std::vector<char *> const &pBPats, int nBPats, int rarity): TruthTableCare(onsets, nInputs, pBPats, nBPats, rarity) {}
 
+  int SigStride(int lev) {
+    if(nInputs - lev > lww) {
+      return 1 + 2 * nSigSamples;
+    }
+    return 2;
+  }
+
+  void ComputeSig(int index, int lev, word *sig) {
+    int logwidth = nInputs - lev;
+    if(logwidth > lww) {
+      int nScopeSize = 1 << (logwidth - lww);
+      int nBlocks = std::min(nScopeSize, ww);
+      int nBlockSize = nScopeSize / nBlocks;
+      sig[0] = 0;
+      for(int b = 0; b < nBlocks; b++) {
+        for(int i = nBlockSize * b; i < nBlockSize * (b + 1); i++) {
+          if(caret[nScopeSize * index + i]) {
+            sig[0] |= 1ull << b;
+            break;
+          }
+        }
+      }
+      int nSamples = std::min(nScopeSize, nSigSamples);
+      for(int k = 0; k < nSigSamples; k++) {
+        if(k < nSamples) {
+          int i = k * (nScopeSize / nSamples);
+          sig[1 + 2 * k] = t[nScopeSize * index + i];
+          sig[2 + 2 * k] = caret[nScopeSize * index + i];
+        } else {
+          sig[1 + 2 * k] = 0;
+          sig[2 + 2 * k] = 0;
+        }
+      }
+    } else {
+      sig[0] = GetValue(index, lev);
+      sig[1] = GetCare(index, lev);
+    }
+  }
+
+  void ResetSigs(int lev) {
+    vvSigs.resize(nInputs);
+    for(int i = lev; i < nInputs; i++) {
+      vvSigs[i].clear();
+    }
+  }
+
   int BDDFindTSM(int index, int lev) {
+    int stride = SigStride(lev);
+    assert(vvSigs[lev].size() == vvIndices[lev].size() * stride);
+    vSig.resize(stride);
+    ComputeSig(index, lev, vSig.data());
     int logwidth = nInputs - lev;
     if(logwidth > lww) {
       int nScopeSize = 1 << (logwidth - lww);
+      int nBlockSize = nScopeSize / std::min(nScopeSize, ww);
       bool fZero = true;
       bool fOne = true;
       for(int i = 0; i < nScopeSize && (fZero || fOne); i++) {
@@ -1453,37 +1995,58 @@ public:
       if(fZero || fOne) {
         return -2 ^ fOne;
       }
-      for(int index2: vvIndices[lev]) {
+      for(uint j = 0; j < vvIndices[lev].size(); j++) {
+        int index2 = vvIndices[lev][j];
+        word *sig2 = &vvSigs[lev][stride * j];
+        // no shared care blocks means compatible, as the full compare would find
+        word occ = vSig[0] & sig2[0];
+        if(!occ) {
+          nFound = j;
+          return index2 << 1;
+        }
         bool fEq = true;
         bool fCompl = true;
-        for(int i = 0; i < nScopeSize && (fEq || fCompl); i++) {
-          word value = t[nScopeSize * index + i] ^ t[nScopeSize * index2 + i];
-          word cvalue = caret[nScopeSize * index + i] & caret[nScopeSize * index2 + i];
+        for(int k = 0; k < nSigSamples; k++) {
+          word value = vSig[1 + 2 * k] ^ sig2[1 + 2 * k];
+          word cvalue = vSig[2 + 2 * k] & sig2[2 + 2 * k];
           fEq &= !(value & cvalue);
           fCompl &= !(~value & cvalue);
         }
+        // compare only the blocks both nodes care about
+        for(; occ && (fEq || fCompl); occ &= occ - 1) {
+          int b = __builtin_ctzll(occ);
+          for(int i = nBlockSize * b; i < nBlockSize * (b + 1) && (fEq || fCompl); i++) {
+            word value = t[nScopeSize * index + i] ^ t[nScopeSize * index2 + i];
+            word cvalue = caret[nScopeSize * index + i] & caret[nScopeSize * index2 + i];
+            fEq &= !(value & cvalue);
+            fCompl &= !(~value & cvalue);
+          }
+        }
         if(fEq || fCompl) {
+          nFound = j;
           return (index2 << 1) ^ !fEq;
         }
       }
     } else {
       word one = ones[logwidth];
-      word value = GetValue(index, lev);
-      word cvalue = GetCare(index, lev);
+      word value = vSig[0];
+      word cvalue = vSig[1];
       if(!(value & cvalue)) {
         return -2;
       }
       if(!((value ^ one) & cvalue)) {
         return -1;
       }
-      for(int index2: vvIndices[lev]) {
-        word value2 = value ^ GetValue(index2, lev);
-        word cvalue2 = cvalue & GetCare(index2, lev);
+      for(uint j = 0; j < vvIndices[lev].size(); j++) {
+        word value2 = value ^ vvSigs[lev][j+j];
+        word cvalue2 = cvalue & vvSigs[lev][j+j+1];
         if(!(value2 & cvalue2)) {
-          return index2 << 1;
+          nFound = j;
+          return vvIndices[lev][j] << 1;
         }
         if(!((value2 ^ one) & cvalue2)) {
-          return (index2 << 1) ^ 1;
+          nFound = j;
+          return (vvIndices[lev][j] << 1) ^ 1;
         }
       }
     }
@@ -1496,19 +2059,26 @@ public:
       if(r >= 0) {
         CopyFuncMasked(r >> 1, index, lev, r & 1);
         Merge(r >> 1, index, lev, r & 1);
+        ComputeSig(r >> 1, lev, &vvSigs[lev][SigStride(lev) * nFound]);
       } else {
         vvMergedIndices[lev].push_back({r, index});
       }
       return r;
     }
     vvIndices[lev].push_back(index);
+    vvSigs[lev].insert(vvSigs[lev].end(), vSig.begin(), vSig.end());
     return index << 1;
   }
 
+  void BDDBuildStartup() override {
+    ResetSigs(0);
+    TruthTableCare::BDDBuildStartup();
+  }
+
   int BDDBuild() override {
-    TruthTable::Save(3);
+    StartJournal();
     int r = TruthTable::BDDBuild();
-    TruthTable::Load(3);
+    Rollback();
     return r;
   }
 
@@ -1522,56 +2092,1303 @@ public:
   }
 
   int BDDRebuild(int lev) override {
-    TruthTable::Save(3);
+    ResetSigs(lev);
+    StartJournal();
     int r = TruthTableCare::BDDRebuild(lev);
-    TruthTable::Load(3);
+    Rollback();
     return r;
   }
+
+  void Optimize() override {
+    ResetSigs(0);
+    TruthTableCare::Optimize();
+  }
 };
 
-void TTTest(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &pBPats, int nBPats, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ofstream &f) {
-  int nInputs = inputs.size();
-  // TruthTable tt(onsets, nInputs);
-  // tt.RandomSiftReo(20);
-  // tt.BDDGenerateBlif(inputs, outputs, f);
+class TruthTableCareReo : public TruthTableCare {
+public:
+  // diagram over {0, 1, dc} leaves, reordered by rewiring vvChildren as in TruthTableReo
+  // a node is not counted if one of its children is dc or if it is compatible with a constant
+  static const int dc = -4;
+  bool fBuilt = false;
+  std::vector<std::vector<int> > vvChildren;
+  std::vector<std::vector<int> > vvConsts; // bit0: compatible with 0, bit1: compatible with 1
+  std::vector<int> vOutputs; // literals of the outputs, level-0 nodes survive every swap
+  std::vector<std::vector<std::vector<int> > > vvChildrenSaved;
+  std::vector<std::vector<std::vector<int> > > vvConstsSaved;
+  ThreadPool *pPool = NULL; // builds large levels with the pool when set
 
-  // TruthTableReo tt(onsets, nInputs);
-  // tt.RandomSiftReo(20);
-  // TruthTable tt2(onsets, nInputs);
-  // tt2.Reo(tt.vLevels);
-  // tt2.BDDGenerateBlif(inputs, outputs, f);
+  TruthTableCareReo(std::vector<std::vector<int> > const &onsets, int nInputs, std::vector<char *> const &pBPats, int nBPats, int rarity): TruthTableCare(onsets, nInputs, pBPats, nBPats, rarity) {}
 
-  // std::vector<int> vLevels;
-  // {
-  //   TruthTable tt(onsets, nInputs);
-  //   tt.RandomSiftReo(20);
-  //   vLevels = tt.vLevels;
-  // }
-  // TruthTableOSM tt(onsets, nInputs, pBPats, nBPats, rarity, false);
-  // tt.Reo(vLevels);
-  // tt.Optimize();
-  // tt.BDDGenerateBlif(inputs, outputs, f);
+  void Reset(std::vector<std::vector<int> > const &onsets, int nInputs, std::vector<char *> const &pBPats, int nBPats, int rarity) {
+    TruthTableCare::Reset(onsets, nInputs, pBPats, nBPats, rarity);
+    fBuilt = false;
+    pPool = NULL;
+  }
 
-  // TruthTableCare tt(onsets, nInputs, pBPats, nBPats, rarity);
-  // TruthTableCareReduce tt(onsets, nInputs, pBPats, nBPats, rarity);
-  // TruthTableOSDM tt(onsets, nInputs, pBPats, nBPats, rarity);
-  // TruthTableOSM tt(onsets, nInputs, pBPats, nBPats, rarity);
-  // TruthTableTSM tt(onsets, nInputs, pBPats, nBPats, rarity);
-  TruthTableLevelTSM tt(onsets, nInputs, pBPats, nBPats, rarity);
-  tt.RandomSiftReo(20);
-  tt.Optimize();
-  tt.BDDGenerateBlif(inputs, outputs, f);
+  void Save(uint i) override {
+    if(vLevelsSaved.size() < i + 1) {
+      vLevelsSaved.resize(i + 1);
+    }
+    vLevelsSaved[i] = vLevels;
+  }
 
-  // TruthTableOSM tt1(onsets, nInputs, pBPats, nBPats, rarity, false);
-  // int r1 = tt1.RandomSiftReo(20);
-  // TruthTableOSM tt2(onsets, nInputs, pBPats, nBPats, rarity, true);
-  // int r2 = tt2.RandomSiftReo(20);
-  // TruthTableCare &tt = (r1 < r2)? tt1: tt2;
-  // tt.Optimize();
-  // tt.BDDGenerateBlif(inputs, outputs, f);
+  void Load(uint i) override {
+    assert(i < vLevelsSaved.size());
+    vLevels = vLevelsSaved[i];
+  }
 
-  // std::cout << tt.BDDBuild() << std::endl;
+  void SaveIndices(uint i) override {
+    TruthTable::SaveIndices(i);
+    if(vvChildrenSaved.size() < i + 1) {
+      vvChildrenSaved.resize(i + 1);
+      vvConstsSaved.resize(i + 1);
+    }
+    vvChildrenSaved[i] = vvChildren;
+    vvConstsSaved[i] = vvConsts;
+  }
+
+  void LoadIndices(uint i) override {
+    TruthTable::LoadIndices(i);
+    vvChildren = vvChildrenSaved[i];
+    vvConsts = vvConstsSaved[i];
+  }
+
+  int Lit(int lit, bool fCompl) {
+    return lit == dc? dc: lit ^ fCompl;
+  }
+
+  int Consts(int lit, int lev) {
+    if(lit == dc) {
+      return 3;
+    }
+    if(lit < 0) {
+      return 1 << (lit & 1);
+    }
+    int r = vvConsts[lev][lit >> 1];
+    return (lit & 1)? ((r & 1) << 1) | (r >> 1): r;
+  }
+
+  bool IsRedundant(int cof0, int cof1, int consts) {
+    return cof0 == cof1 || cof0 == dc || cof1 == dc || consts;
+  }
+
+  int BDDFindCare(int index, int lev) {
+    int logwidth = nInputs - lev;
+    if(logwidth > lww) {
+      int nScopeSize = 1 << (logwidth - lww);
+      bool fDC = true;
+      bool fFull = true;
+      bool fZero = true;
+      bool fOne = true;
+      for(int i = 0; i < nScopeSize; i++) {
+        word value = t[nScopeSize * index + i];
+        word cvalue = caret[nScopeSize * index + i];
+        fDC &= !cvalue;
+        fFull &= !(~cvalue);
+        fZero &= !(value & cvalue);
+        fOne &= !(~value & cvalue);
+      }
+      if(fDC) {
+        return dc;
+      }
+      if(fFull && (fZero || fOne)) {
+        return -2 ^ fOne;
+      }
+      for(uint j = 0; j < vvIndices[lev].size(); j++) {
+        int index2 = vvIndices[lev][j];
+        bool fEq = true;
+        bool fCompl = true;
+        for(int i = 0; i < nScopeSize && (fEq || fCompl); i++) {
+          word cvalue = caret[nScopeSize * index + i];
+          if(cvalue != caret[nScopeSize * index2 + i]) {
+            fEq = fCompl = false;
+            break;
+          }
+          word value = t[nScopeSize * index + i] ^ t[nScopeSize * index2 + i];
+          fEq &= !(value & cvalue);
+          fCompl &= !(~value & cvalue);
+        }
+        if(fEq || fCompl) {
+          return (j << 1) ^ !fEq;
+        }
+      }
+    } else {
+      word one = ones[logwidth];
+      word value = GetValue(index, lev);
+      word cvalue = GetCare(index, lev);
+      if(!cvalue) {
+        return dc;
+      }
+      if(cvalue == one && (!value || value == one)) {
+        return -2 ^ (value == one);
+      }
+      for(uint j = 0; j < vvIndices[lev].size(); j++) {
+        int index2 = vvIndices[lev][j];
+        if(cvalue != GetCare(index2, lev)) {
+          continue;
+        }
+        word value2 = value ^ GetValue(index2, lev);
+        if(!(value2 & cvalue)) {
+          return j << 1;
+        }
+        if(!((value2 ^ one) & cvalue)) {
+          return (j << 1) ^ 1;
+        }
+      }
+    }
+    return -3;
+  }
+
+  int BDDBuildOne(int index, int lev) override {
+    int r = BDDFindCare(index, lev);
+    if(r != -3) {
+      return r;
+    }
+    vvIndices[lev].push_back(index);
+    return (vvIndices[lev].size() - 1) << 1;
+  }
+
+  void BDDBuildStartup() override {
+    RestoreCare();
+    ClearLevels(vvIndices, nInputs);
+    ClearLevels(vvRedundantIndices, nInputs);
+    ClearLevels(vvChildren, nInputs);
+    ClearLevels(vvConsts, nInputs);
+    vOutputs.clear();
+    for(int i = 0; i < nOutputs; i++) {
+      vOutputs.push_back(BDDBuildOne(i, 0));
+    }
+  }
+
+  void BDDBuildLevel(int lev) override {
+    if(pPool && ((long long)vvIndices[lev-1].size() << std::max(nInputs - lev - lww, 0)) >= (1 << 10)) {
+      BDDBuildLevelParallel(lev);
+      return;
+    }
+    for(int index: vvIndices[lev-1]) {
+      int cof0 = BDDBuildOne(index << 1, lev);
+      int cof1 = BDDBuildOne((index << 1) ^ 1, lev);
+      vvChildren[lev-1].push_back(cof0);
+      vvChildren[lev-1].push_back(cof1);
+    }
+  }
+
+  // dc or a constant as BDDFindCare would return, otherwise -3 with a hash of the care and of the value up to complement
+  // fPhase is the value at the first care minterm, the hash is taken on the value complemented by it
+  int BDDClassifyCare(int index, int lev, size_t &hash, bool &fPhase) {
+    int logwidth = nInputs - lev;
+    int nScopeSize = logwidth > lww? 1 << (logwidth - lww): 1;
+    word one = logwidth > lww? ~0ull: ones[logwidth];
+    bool fDC = true;
+    bool fFull = true;
+    bool fZero = true;
+    bool fOne = true;
+    size_t hash0 = 0, hash1 = 0;
+    hash = 0;
+    for(int i = 0; i < nScopeSize; i++) {
+      word value = logwidth > lww? t[nScopeSize * index + i]: GetValue(index, lev);
+      word cvalue = logwidth > lww? caret[nScopeSize * index + i]: GetCare(index, lev);
+      if(fDC && cvalue) {
+        fPhase = (value >> __builtin_ctzll(cvalue)) & 1;
+      }
+      fDC &= !cvalue;
+      fFull &= !(~cvalue & one);
+      fZero &= !(value & cvalue);
+      fOne &= !(~value & cvalue);
+      hash_combine(hash, cvalue);
+      hash_combine(hash0, value & cvalue);
+      hash_combine(hash1, ~value & cvalue);
+    }
+    if(fDC) {
+      return dc;
+    }
+    if(fFull && (fZero || fOne)) {
+      return -2 ^ fOne;
+    }
+    hash_combine(hash, fPhase? hash1: hash0);
+    return -3;
+  }
+
+  bool IsEqCare(int index1, int index2, int lev, bool fCompl) {
+    int logwidth = nInputs - lev;
+    if(logwidth > lww) {
+      int nScopeSize = 1 << (logwidth - lww);
+      word mask = fCompl? ~0ull: 0;
+      for(int i = 0; i < nScopeSize; i++) {
+        word cvalue = caret[nScopeSize * index1 + i];
+        if(cvalue != caret[nScopeSize * index2 + i] || ((t[nScopeSize * index1 + i] ^ t[nScopeSize * index2 + i] ^ mask) & cvalue)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    word cvalue = GetCare(index1, lev);
+    word mask = fCompl? ones[logwidth]: 0;
+    return cvalue == GetCare(index2, lev) && !((GetValue(index1, lev) ^ GetValue(index2, lev) ^ mask) & cvalue);
+  }
+
+  // same vvIndices and vvChildren as the serial loop
+  // the cofactors are classified and hashed in parallel, then each shard of hashes finds the first equivalent cofactor of each,
+  // which is the node the serial loop would have found, and the nodes are numbered in the serial order
+  void BDDBuildLevelParallel(int lev) {
+    std::vector<int> const &vParents = vvIndices[lev-1];
+    int nCofs = 2 * vParents.size();
+    std::vector<int> vClasses(nCofs);
+    std::vector<size_t> vHashes(nCofs);
+    std::vector<char> vPhases(nCofs);
+    std::vector<int> vReps(nCofs);
+    int nParts = 4 * std::max(pPool->NumThreads(), 1);
+    std::atomic<int> nPending(0);
+    for(int p = 0; p < nParts; p++) {
+      pPool->Submit([&, p]() {
+        for(int k = (long long)nCofs * p / nParts; k < (long long)nCofs * (p + 1) / nParts; k++) {
+          bool fPhase = false;
+          vClasses[k] = BDDClassifyCare((vParents[k >> 1] << 1) ^ (k & 1), lev, vHashes[k], fPhase);
+          vPhases[k] = fPhase;
+        }
+      }, nPending);
+    }
+    pPool->Wait(nPending);
+    int nShards = std::max(pPool->NumThreads(), 1);
+    for(int s = 0; s < nShards; s++) {
+      pPool->Submit([&, s]() {
+        std::unordered_map<size_t, std::vector<int> > unique;
+        for(int k = 0; k < nCofs; k++) {
+          if(vClasses[k] != -3 || (int)(vHashes[k] % nShards) != s) {
+            continue;
+          }
+          vReps[k] = k;
+          std::vector<int> &vCands = unique[vHashes[k]];
+          for(int k2: vCands) {
+            if(IsEqCare((vParents[k >> 1] << 1) ^ (k & 1), (vParents[k2 >> 1] << 1) ^ (k2 & 1), lev, vPhases[k] != vPhases[k2])) {
+              vReps[k] = k2;
+              break;
+            }
+          }
+          if(vReps[k] == k) {
+            vCands.push_back(k);
+          }
+        }
+      }, nPending);
+    }
+    pPool->Wait(nPending);
+    std::vector<int> vIds(nCofs);
+    for(int k = 0; k < nCofs; k++) {
+      int lit = vClasses[k];
+      if(lit == -3) {
+        if(vReps[k] == k) {
+          vvIndices[lev].push_back((vParents[k >> 1] << 1) ^ (k & 1));
+          vIds[k] = vvIndices[lev].size() - 1;
+        } else {
+          vIds[k] = vIds[vReps[k]];
+        }
+        lit = (vIds[k] << 1) ^ (vPhases[k] != vPhases[vReps[k]]);
+      }
+      vvChildren[lev-1].push_back(lit);
+    }
+  }
+
+  // cut short by the deadline as in TruthTableReo
+  int BDDBuild() override {
+    if(fBuilt) {
+      return BDDNodeCount();
+    }
+    BDDBuildStartup();
+    for(int i = 1; i < nInputs + 1 && !Cancelled(); i++) {
+      BDDBuildLevel(i);
+    }
+    if(fCancelled) {
+      return INT_MAX;
+    }
+    fBuilt = true;
+    for(int i = nInputs - 1; i >= 0; i--) {
+      for(uint j = 0; j < vvIndices[i].size(); j++) {
+        int cof0 = vvChildren[i][j+j];
+        int cof1 = vvChildren[i][j+j+1];
+        int consts = Consts(cof0, i + 1) & Consts(cof1, i + 1);
+        vvConsts[i].push_back(consts);
+        if(IsRedundant(cof0, cof1, consts)) {
+          vvRedundantIndices[i].push_back(vvIndices[i][j]);
+        }
+      }
+    }
+    return BDDNodeCount();
+  }
+
+  int BDDRebuildOne(int index, int cof0, int cof1, int lev, std::unordered_map<std::pair<int, int>, int> &unique, std::vector<int> &vChildrenLow, std::vector<int> &vConstsLow) {
+    if(cof0 < 0 && cof0 == cof1) {
+      return cof0;
+    }
+    bool fCompl = (cof0 == dc)? cof1 & 1: cof0 & 1;
+    cof0 = Lit(cof0, fCompl);
+    cof1 = Lit(cof1, fCompl);
+    if(unique.count({cof0, cof1})) {
+      return (unique[{cof0, cof1}] << 1) ^ fCompl;
+    }
+    vvIndices[lev].push_back(index);
+    unique[{cof0, cof1}] = vvIndices[lev].size() - 1;
+    vChildrenLow.push_back(cof0);
+    vChildrenLow.push_back(cof1);
+    int consts = Consts(cof0, lev + 1) & Consts(cof1, lev + 1);
+    vConstsLow.push_back(consts);
+    if(IsRedundant(cof0, cof1, consts)) {
+      vvRedundantIndices[lev].push_back(index);
+    }
+    return ((vvIndices[lev].size() - 1) << 1) ^ fCompl;
+  }
+
+  int BDDRebuild(int lev) override {
+    vvRedundantIndices[lev].clear();
+    vvRedundantIndices[lev+1].clear();
+    std::vector<int> vChildrenHigh;
+    std::vector<int> vChildrenLow;
+    std::vector<int> vConstsLow;
+    std::unordered_map<std::pair<int, int>, int> unique;
+    unique.reserve(2 * vvIndices[lev+1].size());
+    vvIndices[lev+1].clear();
+    for(uint i = 0; i < vvIndices[lev].size(); i++) {
+      int index = vvIndices[lev][i];
+      int cof0 = vvChildren[lev][i+i];
+      int cof1 = vvChildren[lev][i+i+1];
+      int cof00 = cof0, cof01 = cof0, cof10 = cof1, cof11 = cof1;
+      if(cof0 >= 0) {
+        cof00 = Lit(vvChildren[lev+1][(cof0 >> 1) << 1], cof0 & 1);
+        cof01 = Lit(vvChildren[lev+1][((cof0 >> 1) << 1) ^ 1], cof0 & 1);
+      }
+      if(cof1 >= 0) {
+        cof10 = Lit(vvChildren[lev+1][(cof1 >> 1) << 1], cof1 & 1);
+        cof11 = Lit(vvChildren[lev+1][((cof1 >> 1) << 1) ^ 1], cof1 & 1);
+      }
+      int newcof0 = BDDRebuildOne(index << 1, cof00, cof10, lev + 1, unique, vChildrenLow, vConstsLow);
+      int newcof1 = BDDRebuildOne((index << 1) ^ 1, cof01, cof11, lev + 1, unique, vChildrenLow, vConstsLow);
+      vChildrenHigh.push_back(newcof0);
+      vChildrenHigh.push_back(newcof1);
+      if(IsRedundant(newcof0, newcof1, vvConsts[lev][i])) {
+        vvRedundantIndices[lev].push_back(index);
+      }
+    }
+    vvChildren[lev] = vChildrenHigh;
+    vvChildren[lev+1] = vChildrenLow;
+    vvConsts[lev+1] = vConstsLow;
+    return BDDNodeCount();
+  }
+
+  void Swap(int lev) override {
+    assert(lev < nInputs - 1);
+    BDDBuild();
+    auto it0 = std::find(vLevels.begin(), vLevels.end(), lev);
+    auto it1 = std::find(vLevels.begin(), vLevels.end(), lev + 1);
+    std::swap(*it0, *it1);
+    if(fBuilt) {
+      BDDRebuild(lev);
+    }
+  }
+
+  int BDDSwap(int lev) override {
+    Swap(lev);
+    return fBuilt? BDDNodeCount(): INT_MAX;
+  }
+
+  // the diagram is the result, with the don't cares resolved as it is written
+  void Optimize() override {
+    BDDBuild();
+  }
+
+  // the literal of the written node for lit at lev, dc being resolved by the caller
+  int BDDNodeLit(std::vector<std::vector<int> > const &vvNodes, int lit, int lev) {
+    if(lit < 0) {
+      return lit + 2;
+    }
+    return vvNodes[lev][lit >> 1] ^ (lit & 1);
+  }
+
+  // as TruthTableReo, with a node compatible with a constant written as that constant,
+  // a node with a dc child as its other child, and an output that is all dc as 0
+  int BDDGenerateBlif(std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f) override {
+    BDDBuild();
+    std::string prefix = outputs.front();
+    int nNodes = 1; // const node
+    std::vector<std::vector<int> > vvNodes(nInputs);
+    f << ".names " << prefix << "n0" << std::endl;
+    for(int i = 0; i < nInputs; i++) {
+      f << ".names " << inputs[i] << " " << prefix << "v" << vLevels[i] << std::endl;
+      f << "1 1" << std::endl;
+    }
+    for(int lev = nInputs - 1; lev >= 0; lev--) {
+      for(uint j = 0; j < vvIndices[lev].size(); j++) {
+        int consts = vvConsts[lev][j];
+        if(consts) {
+          vvNodes[lev].push_back(!(consts & 1));
+          continue;
+        }
+        int lit0 = vvChildren[lev][j+j];
+        int lit1 = vvChildren[lev][j+j+1];
+        int cof0 = BDDNodeLit(vvNodes, lit0 == dc? lit1: lit0, lev + 1);
+        int cof1 = BDDNodeLit(vvNodes, lit1 == dc? lit0: lit1, lev + 1);
+        if(cof0 == cof1) {
+          vvNodes[lev].push_back(cof0);
+          continue;
+        }
+        f << ".names " << prefix << "v" << lev << " " << prefix << "n" << (cof0 >> 1) << " " << prefix << "n" << (cof1 >> 1) << " " << prefix << "n" << nNodes << std::endl;
+        f << "0" << !(cof0 & 1) << "- 1" << std::endl;
+        f << "1-" << !(cof1 & 1) << " 1" << std::endl;
+        vvNodes[lev].push_back((nNodes++) << 1);
+      }
+    }
+    for(int i = 0; i < nOutputs; i++) {
+      int node = vOutputs[i] == dc? 0: BDDNodeLit(vvNodes, vOutputs[i], 0);
+      f << ".names " << prefix << "n" << (node >> 1) << " " << outputs[i] << std::endl;
+      f << !(node & 1) << " 1" << std::endl;
+    }
+    return nNodes;
+  }
+};
+
+// an engine taken from a per-thread free list, where it returns when this goes out of scope,
+// so that the engines of successive groups reuse the memory of their vectors instead of allocating it again
+// a thread waiting in the pool may run another group meanwhile, which then takes another engine
+// engines whose table grew beyond nMaxWords are freed instead, not to keep the memory of a large group
+template <class T>
+class PooledEngine {
+public:
+  static const size_t nMaxWords = 1 << 16;
+
+  PooledEngine() {
+    auto &vFree = Free();
+    if(!vFree.empty()) {
+      p = std::move(vFree.back());
+      vFree.pop_back();
+    }
+  }
+
+  ~PooledEngine() {
+    if(p && p->t.capacity() <= nMaxWords) {
+      Free().push_back(std::move(p));
+    }
+  }
+
+  // same arguments as the constructor of T
+  template <class... Args>
+  T &Init(Args const &...args) {
+    if(p) {
+      p->Reset(args...);
+    } else {
+      p.reset(new T(args...));
+    }
+    return *p;
+  }
+
+  T &Copy(T const &tt) {
+    if(p) {
+      *p = tt;
+    } else {
+      p.reset(new T(tt));
+    }
+    return *p;
+  }
+
+private:
+  std::unique_ptr<T> p;
+
+  static std::vector<std::unique_ptr<T> > &Free() {
+    static thread_local std::vector<std::unique_ptr<T> > vFree;
+    return vFree;
+  }
+};
+
+// same result as tt.SiftReo(), with the downward and upward sweeps of each variable run at once,
+// the upward one as a task of the pool on a copy of tt taken before the downward one starts
+// the upward sweep keeps its order only if it beats the best of the downward one, as in the serial loop,
+// where the upward sweep compares against the best found so far
+template <class T>
+int BidirectionalSiftReo(T &tt, ThreadPool &pool) {
+  int best = tt.BDDBuild();
+  tt.Save(0);
+  tt.SaveIndices(0);
+  std::vector<int> vars(tt.nInputs);
+  std::iota(vars.begin(), vars.end(), 0);
+  std::sort(vars.begin(), vars.end(), [&](int i1, int i2) {return tt.BDDNodeCountLevel(tt.vLevels[i1]) > tt.BDDNodeCountLevel(tt.vLevels[i2]);});
+  bool turn = true;
+  PooledEngine<T> pooled;
+  for(int var: vars) {
+    int lev = tt.vLevels[var];
+    int bestDown = best, bestUp = best;
+    T *pUp = NULL;
+    std::atomic<int> nPending(0);
+    if(lev) {
+      // slot !turn of the copy holds the state at the start of the pass as in tt
+      pUp = &pooled.Copy(tt);
+      pool.Submit([&]() {
+        for(int i = lev - 1; i >= 0 && !pUp->Cancelled(); i--) {
+          int count = pUp->BDDSwap(i);
+          if(bestUp > count) {
+            bestUp = count;
+            pUp->Save(turn);
+            pUp->SaveIndices(turn);
+          }
+        }
+      }, nPending);
+    }
+    for(int i = lev; i < tt.nInputs - 1 && !tt.Cancelled(); i++) {
+      int count = tt.BDDSwap(i);
+      if(bestDown > count) {
+        bestDown = count;
+        tt.Save(turn);
+        tt.SaveIndices(turn);
+      }
+    }
+    pool.Wait(nPending);
+    bool updated = false;
+    if(std::min(best, bestDown) > bestUp) {
+      tt = *pUp;
+      best = bestUp;
+      updated = true;
+    } else if(best > bestDown) {
+      best = bestDown;
+      updated = true;
+    }
+    turn ^= updated;
+    tt.Load(!turn);
+    tt.LoadIndices(!turn);
+    if(tt.fCancelled || (pUp && pUp->fCancelled)) {
+      tt.fCancelled = true;
+      break;
+    }
+  }
+  return best;
+}
+
+// same result as tt.RandomSiftReo(nRound), with the rounds run as tasks of the pool on copies of tt
+// the shuffles are drawn up front from tt.rng, and ties go to the earliest round as in the serial loop
+template <class T>
+int ParallelRandomSiftReo(T &tt, int nRound, ThreadPool &pool) {
+  std::vector<std::vector<int> > vOrders(nRound + 1, tt.vLevels);
+  for(int i = 1; i <= nRound; i++) {
+    std::iota(vOrders[i].begin(), vOrders[i].end(), 0);
+    std::shuffle(vOrders[i].begin(), vOrders[i].end(), tt.rng);
+  }
+  std::vector<int> vCounts(nRound + 1);
+  std::vector<std::vector<int> > vResults(nRound + 1);
+  std::atomic<int> nPending(0);
+  for(int i = 0; i <= nRound; i++) {
+    pool.Submit([&, i]() {
+      PooledEngine<T> pooled;
+      T &tt2 = pooled.Copy(tt);
+      tt2.Reo(vOrders[i]);
+      vCounts[i] = tt2.SiftReo();
+      vResults[i] = tt2.vLevels;
+    }, nPending);
+  }
+  pool.Wait(nPending);
+  int best = 0;
+  for(int i = 1; i <= nRound; i++) {
+    if(vCounts[best] > vCounts[i]) {
+      best = i;
+    }
+  }
+  tt.Reo(vResults[best]);
+  return vCounts[best];
+}
+
+// the care set is pCare if not NULL, computed once by the caller, then the counts pCount of a streamed sim if not NULL,
+// and otherwise the patterns of pBPats
+TruthTable *CreateEngine(std::string const &name, std::vector<std::vector<int> > const &onsets, int nInputs, std::vector<char *> const &pBPats, int nBPats, PatternCounter const *pCount, std::vector<TruthTable::word> const *pCare, int rarity) {
+  if(pCare) {
+    // nothing to count, the care is copied below
+    nBPats = 0;
+    pCount = NULL;
+  }
+  if(name == "bdd") {
+    return new TruthTable(onsets, nInputs);
+  }
+  if(name == "reo") {
+    return new TruthTableReo(onsets, nInputs);
+  }
+  TruthTableCare *tt = NULL;
+  if(name == "care") {
+    tt = new TruthTableCare(onsets, nInputs, pBPats, nBPats, rarity);
+  }
+  if(name == "carereduce") {
+    tt = new TruthTableCareReduce(onsets, nInputs, pBPats, nBPats, rarity);
+  }
+  if(name == "osdm") {
+    tt = new TruthTableOSDM(onsets, nInputs, pBPats, nBPats, rarity);
+  }
+  if(name == "osm") {
+    tt = new TruthTableOSM(onsets, nInputs, pBPats, nBPats, rarity);
+  }
+  if(name == "osm-nocompl") {
+    tt = new TruthTableOSM(onsets, nInputs, pBPats, nBPats, rarity, false);
+  }
+  if(name == "tsm") {
+    tt = new TruthTableTSM(onsets, nInputs, pBPats, nBPats, rarity);
+  }
+  if(name == "tsm-nocompl") {
+    tt = new TruthTableTSM(onsets, nInputs, pBPats, nBPats, rarity, false);
+  }
+  if(name == "levtsm") {
+    tt = new TruthTableLevelTSM(onsets, nInputs, pBPats, nBPats, rarity);
+  }
+  if(name == "carereo") {
+    tt = new TruthTableCareReo(onsets, nInputs, pBPats, nBPats, rarity);
+  }
+  if(tt && pCare) {
+    tt->care = *pCare;
+  } else if(tt && pCount) {
+    tt->SetCare(*pCount, rarity);
+  }
+  return tt;
+}
+
+// the order of the variables of vLevels by level and back
+inline std::vector<int> LevelsToVars(std::vector<int> const &vLevels) {
+  std::vector<int> vVars(vLevels.size());
+  for(unsigned i = 0; i < vLevels.size(); i++) {
+    vVars[vLevels[i]] = i;
+  }
+  return vVars;
+}
+
+// order crossover: the levels [begin, end) of the first parent in place, the other variables in the order of the second
+inline std::vector<int> CrossOrders(std::vector<int> const &vLevels0, std::vector<int> const &vLevels1, std::mt19937 &rng) {
+  int nInputs = vLevels0.size();
+  std::vector<int> vVars0 = LevelsToVars(vLevels0);
+  std::vector<int> vVars1 = LevelsToVars(vLevels1);
+  int begin = rng() % nInputs;
+  int end = begin + 1 + rng() % (nInputs - begin);
+  std::vector<int> vVars(nInputs, -1);
+  std::vector<bool> vTaken(nInputs);
+  for(int lev = begin; lev < end; lev++) {
+    vVars[lev] = vVars0[lev];
+    vTaken[vVars0[lev]] = true;
+  }
+  int lev = 0;
+  for(int var: vVars1) {
+    if(vTaken[var]) {
+      continue;
+    }
+    while(vVars[lev] >= 0) {
+      lev++;
+    }
+    vVars[lev] = var;
+  }
+  return LevelsToVars(vVars);
+}
+
+// island search over orders, a deterministic alternative to RandomSiftReo for about the same number of swaps
+// each island sifts a few random orders on its own pooled copy of tt, then every generation it crosses two of them,
+// anneals the child by random adjacent swaps, sifts it, and replaces its worst order if the child is better
+// the islands run in parallel between generations, after which the best order found is given to all of them
+// islands are seeded from tt.rng and their number is the number of threads, so results depend on both only
+template <class T>
+int PopulationReo(T &tt, int nRound, ThreadPool *pPool) {
+  static const int nKeep = 4;
+  struct Island {
+    std::mt19937 rng;
+    PooledEngine<T> pooled;
+    T *pEngine = NULL; // copied from tt once into pooled, and reordered by every generation
+    std::vector<std::pair<int, std::vector<int> > > vOrders; // (count, levels)
+  };
+  int nInputs = tt.nInputs;
+  int nIslands = pPool? std::max(1, pPool->NumThreads()): 1;
+  // as many swaps as the sifts of RandomSiftReo, spread over the islands
+  // a sift takes about nInputs*(nInputs-1) swaps, and a crossed generation anneals by 2*nInputs more before its sift
+  long long nSiftSwaps = (long long)nInputs * (nInputs - 1);
+  int nGenerations = std::max(1ll, (nRound + nIslands) * nSiftSwaps / (nIslands * (nSiftSwaps + 2 * nInputs)));
+  // generations of random orders before the crossings start, at most half of them
+  int nSeeds = std::min(nKeep, std::max(1, nGenerations / 2));
+  std::vector<Island> vIslands(nIslands);
+  for(auto &island: vIslands) {
+    island.rng.seed(tt.rng());
+  }
+  std::vector<int> vCurrent = tt.vLevels;
+  auto Generation = [&](int iIsland, int gen) {
+    Island &island = vIslands[iIsland];
+    if(!island.pEngine) {
+      island.pEngine = &island.pooled.Copy(tt);
+    }
+    T &tt2 = *island.pEngine;
+    std::vector<int> vLevelsNew;
+    if(gen < nSeeds) {
+      // the population starts from random orders, and from the current one on the first island
+      vLevelsNew = vCurrent;
+      if(iIsland || gen) {
+        std::shuffle(vLevelsNew.begin(), vLevelsNew.end(), island.rng);
+      }
+    } else {
+      int n = island.vOrders.size();
+      int i0 = island.rng() % n;
+      int i1 = island.rng() % n;
+      vLevelsNew = CrossOrders(island.vOrders[i0].second, island.vOrders[i1].second, island.rng);
+    }
+    tt2.Reo(vLevelsNew);
+    if(gen >= nSeeds) {
+      // the temperature falls from about 2% of the nodes to nothing over the generations
+      int count = tt2.BDDBuild();
+      int best = count;
+      tt2.Save(3);
+      tt2.SaveIndices(3);
+      double temp = 0.02 * count * (nGenerations - gen) / nGenerations;
+      std::uniform_real_distribution<double> uniform(0, 1);
+      for(int step = 0; step < 2 * nInputs && !tt2.Cancelled(); step++) {
+        int lev = island.rng() % (nInputs - 1);
+        int r = tt2.BDDSwap(lev);
+        if(r <= count || (temp > 0 && uniform(island.rng) < std::exp((count - r) / temp))) {
+          count = r;
+          if(best > count) {
+            best = count;
+            tt2.Save(3);
+            tt2.SaveIndices(3);
+          }
+        } else {
+          tt2.BDDSwap(lev);
+        }
+      }
+      tt2.Load(3);
+      tt2.LoadIndices(3);
+    }
+    int r = tt2.SiftReo();
+    auto &vOrders = island.vOrders;
+    for(auto const &order: vOrders) {
+      if(order.second == tt2.vLevels) {
+        return;
+      }
+    }
+    if((int)vOrders.size() < nKeep) {
+      vOrders.push_back({r, tt2.vLevels});
+    } else {
+      auto worst = std::max_element(vOrders.begin(), vOrders.end());
+      if(worst->first > r) {
+        *worst = {r, tt2.vLevels};
+      }
+    }
+  };
+  std::pair<int, std::vector<int> > best(INT_MAX, vCurrent);
+  for(int gen = 0; gen < nGenerations && !tt.Cancelled(); gen++) {
+    if(nIslands == 1) {
+      Generation(0, gen);
+    } else {
+      std::atomic<int> nPending(0);
+      for(int i = 0; i < nIslands; i++) {
+        pPool->Submit([&, i, gen]() { Generation(i, gen); }, nPending);
+      }
+      pPool->Wait(nPending);
+    }
+    for(auto const &island: vIslands) {
+      for(auto const &order: island.vOrders) {
+        if(best.first > order.first) {
+          best = order;
+        }
+      }
+    }
+    for(auto &island: vIslands) {
+      auto worst = std::max_element(island.vOrders.begin(), island.vOrders.end());
+      if(std::find(island.vOrders.begin(), island.vOrders.end(), best) == island.vOrders.end() && worst->first > best.first) {
+        *worst = best;
+      }
+    }
+  }
+  tt.Reo(best.second);
+  return best.first;
+}
+
+// set by SetOrderDatabase, small groups reordered by -x are searched exhaustively every time without it
+static OrderDatabase *pOrderDatabase = NULL;
+
+// reorders a group small enough for all orders to be tried, looking its permutation class up first
+// the orders tried exhaustively are recorded for the class, unless the search was cancelled
+void SmallReo(TruthTableCare &tt) {
+  if(!pOrderDatabase) {
+    tt.ExhaustiveReo();
+    return;
+  }
+  std::vector<int> vLevelsCanon;
+  std::string key = tt.CanonicalKey(vLevelsCanon);
+  std::vector<int> vOrder;
+  if(pOrderDatabase->Lookup(key, vOrder) && (int)vOrder.size() == tt.nInputs) {
+    std::vector<int> vLevelsNew(tt.nInputs);
+    for(int i = 0; i < tt.nInputs; i++) {
+      vLevelsNew[i] = vOrder[vLevelsCanon[i]];
+    }
+    tt.Reo(vLevelsNew);
+    return;
+  }
+  tt.ExhaustiveReo();
+  if(tt.Cancelled()) {
+    return;
+  }
+  vOrder.resize(tt.nInputs);
+  for(int i = 0; i < tt.nInputs; i++) {
+    vOrder[vLevelsCanon[i]] = tt.vLevels[i];
+  }
+  pOrderDatabase->Insert(key, vOrder);
+}
+
+bool IsSmallGroup(int nInputs, int nOutputs) {
+  return nInputs <= 5 || (nInputs == 6 && nOutputs == 1);
+}
+
+bool CheckStrategy(std::string const &strategy) {
+  static const std::vector<std::string> vEngines = {"bdd", "reo", "care", "carereduce", "osdm", "osm", "osm-nocompl", "tsm", "tsm-nocompl", "levtsm", "carereo"};
+  std::string sifter = strategy.substr(0, strategy.find('+'));
+  std::string engine = strategy.substr(strategy.find('+') + 1);
+  auto IsEngine = [&](std::string const &name) {
+    return std::find(vEngines.begin(), vEngines.end(), name) != vEngines.end();
+  };
+  return IsEngine(sifter) && IsEngine(engine);
+}
+
+// the deadline of a search or an Optimize starting now, none if budget is 0
+std::chrono::steady_clock::time_point Deadline(double budget) {
+  if(!budget) {
+    return std::chrono::steady_clock::time_point::max();
+  }
+  return std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budget));
+}
+
+// the engines keep about eight copies of a table: the table, the original, the care, and the saved ones
+long long EstimateBytes(int nInputs, int nOutputs) {
+  return 8ll * nOutputs * std::max(1ll << nInputs >> 3, 8ll);
+}
+
+// writes the onsets as they were read, for groups over budget
+void WriteCover(std::vector<std::vector<int> > const &onsets, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f) {
+  for(uint i = 0; i < outputs.size(); i++) {
+    f << ".names";
+    for(auto const &input: inputs) {
+      f << " " << input;
+    }
+    f << " " << outputs[i] << std::endl;
+    for(int pat: onsets[i]) {
+      f << BinaryToString(pat, inputs.size()) << " 1" << std::endl;
+    }
+  }
+}
+
+// sifts with the engine of the strategy (or with the sifter of "sifter+engine" and applies its order),
+// then optimizes and writes the result, returns the number of nodes
+// returns INT_MAX without writing anything if Optimize ran over budget
+int RunStrategy(std::string const &strategy, std::vector<std::vector<int> > const &onsets, std::vector<char *> const &pBPats, int nBPats, PatternCounter const *pCount, std::vector<TruthTable::word> const *pCare, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f, int nRounds, double budget, std::atomic<int> &best, std::vector<int> &vLevels) {
+  int nInputs = inputs.size();
+  std::string sifter = strategy.substr(0, strategy.find('+'));
+  std::string engine = strategy.substr(strategy.find('+') + 1);
+  std::unique_ptr<TruthTable> tt(CreateEngine(engine, onsets, nInputs, pBPats, nBPats, pCount, pCare, rarity));
+  tt->deadline = Deadline(budget);
+  if(sifter == engine) {
+    // give up the remaining rounds when behind a finished strategy after half of them
+    tt->Stop = [&](int round, int count) {
+      return round >= nRounds / 2 && count > best;
+    };
+    tt->RandomSiftReo(nRounds);
+  } else {
+    std::unique_ptr<TruthTable> ttr(CreateEngine(sifter, onsets, nInputs, pBPats, nBPats, pCount, pCare, rarity));
+    ttr->deadline = tt->deadline;
+    ttr->RandomSiftReo(nRounds);
+    tt->Reo(ttr->vLevels);
+  }
+  tt->deadline = Deadline(budget);
+  tt->fCancelled = false;
+  tt->Optimize();
+  if(tt->fCancelled) {
+    return INT_MAX;
+  }
+  // written whole, the structural engine may build again here
+  tt->deadline = std::chrono::steady_clock::time_point::max();
+  vLevels = tt->vLevels;
+  return tt->BDDGenerateBlif(inputs, outputs, f);
+}
+
+int Portfolio(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &pBPats, int nBPats, PatternCounter const *pCount, std::vector<TruthTable::word> const *pCare, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f, Params const &params, std::string &engine, std::vector<int> &vLevels) {
+  auto deadline = Deadline(params.budget);
+  int nStrategies = params.vStrategies.size();
+  std::vector<std::string> vBlifs(nStrategies);
+  std::vector<int> vCounts(nStrategies);
+  std::vector<std::vector<int> > vvLevels(nStrategies);
+  std::atomic<int> best(INT_MAX);
+  std::vector<std::thread> vThreads;
+  for(int i = 0; i < nStrategies; i++) {
+    vThreads.emplace_back([&, i]() {
+      std::stringstream ss;
+      vCounts[i] = RunStrategy(params.vStrategies[i], onsets, pBPats, nBPats, pCount, pCare, rarity, inputs, outputs, ss, params.nRounds, params.budget, best, vvLevels[i]);
+      vBlifs[i] = ss.str();
+      int prev = best;
+      while(vCounts[i] < prev && !best.compare_exchange_weak(prev, vCounts[i])) {}
+    });
+  }
+  for(auto &th: vThreads) {
+    th.join();
+  }
+  int winner = std::min_element(vCounts.begin(), vCounts.end()) - vCounts.begin();
+  if(vCounts[winner] == INT_MAX) {
+    WriteCover(onsets, inputs, outputs, f);
+    vLevels.clear();
+    return 2;
+  }
+  f << vBlifs[winner];
+  std::string const &strategy = params.vStrategies[winner];
+  engine = strategy.substr(strategy.find('+') + 1);
+  vLevels = vvLevels[winner];
+  if(params.fReport) {
+    std::cout << outputs.front() << " " << inputs.size() << " " << strategy << " " << vCounts[winner] << std::endl;
+  }
+  return std::chrono::steady_clock::now() > deadline;
+}
+
+// optimizes a group and writes it, the engine and the order of the result are returned for the cache
+// a non-empty vLevels on entry is the order the first sifting starts from
+// returns 0 within budget, 1 if the search ran over it and kept its best order so far,
+// and 2 if the original cover was written, because the tables would not fit or Optimize ran over budget too
+// the care set is taken as in CreateEngine
+int OptimizeGroup(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &pBPats, int nBPats, PatternCounter const *pCount, std::vector<TruthTable::word> const *pCare, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f, Params const &params, ThreadPool *pPool, std::string &engine, std::vector<int> &vLevels) {
+  int nInputs = inputs.size();
+  if(params.nBudgetBytes && EstimateBytes(nInputs, outputs.size()) > params.nBudgetBytes) {
+    WriteCover(onsets, inputs, outputs, f);
+    vLevels.clear();
+    return 2;
+  }
+  if(!params.vStrategies.empty()) {
+    return Portfolio(onsets, pBPats, nBPats, pCount, pCare, rarity, inputs, outputs, f, params, engine, vLevels);
+  }
+  auto deadline = Deadline(params.budget);
+  // TruthTable tt(onsets, nInputs);
+  // tt.RandomSiftReo(20);
+  // tt.BDDGenerateBlif(inputs, outputs, f);
+
+  // TruthTableReo tt(onsets, nInputs);
+  // tt.RandomSiftReo(20);
+  // tt.BDDGenerateBlif(inputs, outputs, f);
+
+  // std::vector<int> vLevels;
+  // {
+  //   TruthTable tt(onsets, nInputs);
+  //   tt.RandomSiftReo(20);
+  //   vLevels = tt.vLevels;
+  // }
+  // TruthTableOSM tt(onsets, nInputs, pBPats, nBPats, rarity, false);
+  // tt.Reo(vLevels);
+  // tt.Optimize();
+  // tt.BDDGenerateBlif(inputs, outputs, f);
+
+  // TruthTableCare tt(onsets, nInputs, pBPats, nBPats, rarity);
+  // TruthTableCareReduce tt(onsets, nInputs, pBPats, nBPats, rarity);
+  // TruthTableOSDM tt(onsets, nInputs, pBPats, nBPats, rarity);
+  // TruthTableOSM tt(onsets, nInputs, pBPats, nBPats, rarity);
+  // TruthTableTSM tt(onsets, nInputs, pBPats, nBPats, rarity);
+  PooledEngine<TruthTableLevelTSM> pooled;
+  TruthTableLevelTSM &tt = pooled.Init(onsets, nInputs, pBPats, pCare? 0: nBPats, pCare? 0: rarity);
+  if(pCare) {
+    tt.care = *pCare;
+  } else if(pCount) {
+    tt.SetCare(*pCount, rarity);
+  }
+  tt.deadline = deadline;
+  if(nInputs > 20) {
+    // reorder structurally, table swaps are too expensive here
+    TruthTableCareReo ttr(onsets, nInputs, pBPats, 0, 0);
+    ttr.care = tt.care;
+    ttr.deadline = deadline;
+    // set before the warm start, whose Reo does the first full build
+    ttr.pPool = pPool;
+    if(!vLevels.empty()) {
+      ttr.Reo(vLevels);
+    }
+    if(params.fPopulation) {
+      // built once here, the islands copy the diagram
+      ttr.BDDBuild();
+      PopulationReo(ttr, params.nRounds, pPool);
+    } else if(pPool && params.fBidirectional) {
+      ttr.RandomSiftReo(params.nRounds, [&]() {return BidirectionalSiftReo(ttr, *pPool);});
+    } else if(pPool) {
+      ttr.BDDBuild();
+      ParallelRandomSiftReo(ttr, params.nRounds, *pPool);
+    } else {
+      ttr.RandomSiftReo(params.nRounds);
+    }
+    tt.Reo(ttr.vLevels);
+  } else if(params.fExhaustive && IsSmallGroup(nInputs, outputs.size())) {
+    // all orders are cheaper than the sifting rounds here, and no seed is needed
+    SmallReo(tt);
+  } else {
+    if(!vLevels.empty()) {
+      tt.Reo(vLevels);
+    }
+    if(params.fPopulation && nInputs >= 10) {
+      PopulationReo(tt, params.nRounds, pPool);
+    } else if(pPool && params.fBidirectional && nInputs >= 10) {
+      tt.RandomSiftReo(params.nRounds, [&]() {return BidirectionalSiftReo(tt, *pPool);});
+    } else if(pPool && nInputs >= 10) {
+      ParallelRandomSiftReo(tt, params.nRounds, *pPool);
+    } else {
+      tt.RandomSiftReo(params.nRounds);
+    }
+  }
+  int status = tt.Cancelled();
+  // Optimize gets a budget of its own
+  tt.deadline = Deadline(params.budget);
+  tt.fCancelled = false;
+  tt.Optimize();
+  if(tt.fCancelled) {
+    WriteCover(onsets, inputs, outputs, f);
+    vLevels.clear();
+    return 2;
+  }
+  tt.BDDGenerateBlif(inputs, outputs, f);
+  engine = "levtsm";
+  vLevels = tt.vLevels;
+  return status;
+
+  // TruthTableOSM tt1(onsets, nInputs, pBPats, nBPats, rarity, false);
+  // int r1 = tt1.RandomSiftReo(20);
+  // TruthTableOSM tt2(onsets, nInputs, pBPats, nBPats, rarity, true);
+  // int r2 = tt2.RandomSiftReo(20);
+  // TruthTableCare &tt = (r1 < r2)? tt1: tt2;
+  // tt.Optimize();
+  // tt.BDDGenerateBlif(inputs, outputs, f);
+
+  // std::cout << tt.BDDBuild() << std::endl;
   // tt.GeneratePlaCare("care.pla");
   // tt.GeneratePlaMasked("test.pla");
   // tt.BDDGenerateBlif(inputs, outputs, f);
 }
+
+// the care set of a group, computed once for the cache key and the engines of a miss
+std::vector<TruthTable::word> GroupCare(std::vector<char *> const &pBPats, int nBPats, PatternCounter const *pCount, int rarity, int nInputs) {
+  // no outputs, only the care is wanted
+  TruthTableCare tt(std::vector<std::vector<int> >(), nInputs, pBPats, pCount? 0: nBPats, rarity);
+  if(pCount) {
+    tt.SetCare(*pCount, rarity);
+  }
+  return tt.care;
+}
+
+// the key covers the function, the care set, and the parameters that affect the result
+// the onsets are hashed sorted, so the key does not depend on the order of the cubes
+std::string CacheKey(std::vector<std::vector<int> > const &onsets, std::vector<TruthTable::word> const &care, int rarity, int nInputs, Params const &params, ThreadPool *pPool) {
+  std::stringstream ss;
+  ss << nInputs << " " << onsets.size() << " " << rarity << " " << params.nRounds << " " << params.fWarmStart << " " << params.fPopulation << " " << params.fExhaustive;
+  if(params.fPopulation) {
+    // one island per thread of the pool the group runs on, which a server job does not choose
+    ss << " " << (pPool? std::max(1, pPool->NumThreads()): 1);
+  }
+  for(auto const &strategy: params.vStrategies) {
+    ss << " " << strategy;
+  }
+  std::string str = ss.str();
+  std::vector<std::vector<int> > vSorted(onsets);
+  for(auto &onset: vSorted) {
+    std::sort(onset.begin(), onset.end());
+    onset.erase(std::unique(onset.begin(), onset.end()), onset.end());
+  }
+  std::string key;
+  for(uint64_t seed: {0ull, 0x9e3779b97f4a7c15ull}) {
+    uint64_t h = ResultCache::Hash(str.data(), str.size(), seed);
+    for(auto const &onset: vSorted) {
+      // the size separates the outputs
+      int nPats = onset.size();
+      h = ResultCache::Hash(&nPats, sizeof(nPats), h);
+      h = ResultCache::Hash(onset.data(), onset.size() * sizeof(onset[0]), h);
+    }
+    if(rarity) {
+      h = ResultCache::Hash(care.data(), care.size() * sizeof(care[0]), h);
+    }
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+    key += buf;
+  }
+  return key;
+}
+
+std::string CacheNameKey(std::vector<std::string> const &inputs, std::vector<std::string> const &outputs) {
+  std::string str;
+  for(auto const &name: inputs) {
+    str += name + " ";
+  }
+  str += ":";
+  for(auto const &name: outputs) {
+    str += " " + name;
+  }
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)ResultCache::Hash(str.data(), str.size(), 0));
+  return buf;
+}
+
+// looks the group up in the cache of ctx if any before optimizing it
+// the patterns are either the columns pBPats of nBPats bytes, or the counts pCount of a streamed sim if not NULL
+// returns the status of OptimizeGroup, results over budget are not cached
+int OptimizeGroupCached(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &pBPats, int nBPats, PatternCounter const *pCount, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f, Params const &params, Context const &ctx) {
+  std::string engine;
+  std::vector<int> vLevels;
+  if(!ctx.pCache) {
+    if(ctx.pHints) {
+      vLevels = ctx.pHints->Lookup(inputs);
+    }
+    int status = OptimizeGroup(onsets, pBPats, nBPats, pCount, NULL, rarity, inputs, outputs, f, params, ctx.pPool, engine, vLevels);
+    if(ctx.pHints) {
+      ctx.pHints->Record(inputs, vLevels);
+    }
+    return status;
+  }
+  int nInputs = inputs.size();
+  std::vector<TruthTable::word> care = GroupCare(pBPats, nBPats, pCount, rarity, nInputs);
+  std::string key = CacheKey(onsets, care, rarity, nInputs, params, ctx.pPool);
+  std::string namekey = CacheNameKey(inputs, outputs);
+  std::string blif;
+  if(ctx.pCache->Lookup(key, namekey, engine, vLevels, blif)) {
+    if(!blif.empty()) {
+      if(ctx.pHints) {
+        ctx.pHints->Record(inputs, vLevels);
+      }
+      f << blif;
+      return 0;
+    }
+    // the same function under other names, only the order is reused
+    // the engine comes from the cache file, which may name one this build does not know
+    std::unique_ptr<TruthTable> tt(CheckStrategy(engine)? CreateEngine(engine, onsets, nInputs, pBPats, nBPats, pCount, &care, rarity): NULL);
+    if(tt && (int)vLevels.size() == nInputs) {
+      if(ctx.pHints) {
+        ctx.pHints->Record(inputs, vLevels);
+      }
+      tt->Reo(vLevels);
+      tt->deadline = Deadline(params.budget);
+      tt->Optimize();
+      if(tt->fCancelled) {
+        WriteCover(onsets, inputs, outputs, f);
+        return 2;
+      }
+      tt->deadline = std::chrono::steady_clock::time_point::max();
+      std::stringstream ss;
+      tt->BDDGenerateBlif(inputs, outputs, ss);
+      if(params.fCacheBlif) {
+        ctx.pCache->Insert(key, namekey, engine, vLevels, ss.str());
+      }
+      f << ss.str();
+      return 0;
+    }
+  }
+  vLevels.clear();
+  if(ctx.pHints) {
+    vLevels = ctx.pHints->Lookup(inputs);
+  }
+  std::stringstream ss;
+  int status = OptimizeGroup(onsets, pBPats, nBPats, pCount, &care, rarity, inputs, outputs, ss, params, ctx.pPool, engine, vLevels);
+  if(ctx.pHints) {
+    ctx.pHints->Record(inputs, vLevels);
+  }
+  if(!status) {
+    ctx.pCache->Insert(key, namekey, engine, vLevels, params.fCacheBlif? ss.str(): "");
+  }
+  f << ss.str();
+  return status;
+}
+
+// optimizes the group once per threshold of params.vRarities, from a single pattern histogram
+// thresholds are visited in increasing order, so each care set contains the next, and each run starts from the previous order
+// the result for the first threshold listed is written, and the node counts are added to ctx.pSweep
+// the histogram is pCount if not NULL, which is then capped at the largest threshold or more
+// each threshold gets the budgets of OptimizeGroup, and the thresholds whose cover is written are left out of ctx.pSweep
+// returns the largest status of OptimizeGroup over the thresholds
+int RaritySweep(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &pBPats, int nBPats, PatternCounter const *pCount, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f, Params const &params, Context const &ctx) {
+  int nInputs = inputs.size();
+  if(params.nBudgetBytes && EstimateBytes(nInputs, outputs.size()) > params.nBudgetBytes) {
+    WriteCover(onsets, inputs, outputs, f);
+    return 2;
+  }
+  int nRarities = params.vRarities.size();
+  std::vector<int> vOrder(nRarities);
+  std::iota(vOrder.begin(), vOrder.end(), 0);
+  std::stable_sort(vOrder.begin(), vOrder.end(), [&](int i1, int i2) { return params.vRarities[i1] < params.vRarities[i2]; });
+  TruthTableCare ttc(onsets, nInputs, pBPats, 0, 0);
+  PatternCounter counted(0, 0, 1);
+  if(!pCount) {
+    counted = ttc.CountPatterns(pBPats, nBPats, *std::max_element(params.vRarities.begin(), params.vRarities.end()));
+    pCount = &counted;
+  }
+  std::vector<int> vLevels;
+  std::vector<long long> vNodes(nRarities);
+  int status = 0;
+  for(int k: vOrder) {
+    std::vector<TruthTable::word> care = ttc.CareFromCounts(*pCount, params.vRarities[k]);
+    PooledEngine<TruthTableLevelTSM> pooled;
+    TruthTableLevelTSM &tt = pooled.Init(onsets, nInputs, pBPats, 0, 0);
+    tt.care = care;
+    tt.deadline = Deadline(params.budget);
+    if(nInputs > 20) {
+      TruthTableCareReo ttr(onsets, nInputs, pBPats, 0, 0);
+      ttr.care = care;
+      ttr.deadline = tt.deadline;
+      if(!vLevels.empty()) {
+        ttr.Reo(vLevels);
+      }
+      ttr.RandomSiftReo(params.nRounds);
+      tt.Reo(ttr.vLevels);
+    } else if(params.fExhaustive && IsSmallGroup(nInputs, outputs.size())) {
+      SmallReo(tt);
+    } else {
+      if(!vLevels.empty()) {
+        tt.Reo(vLevels);
+      }
+      if(ctx.pPool && nInputs >= 10) {
+        ParallelRandomSiftReo(tt, params.nRounds, *ctx.pPool);
+      } else {
+        tt.RandomSiftReo(params.nRounds);
+      }
+    }
+    status = std::max(status, (int)tt.Cancelled());
+    tt.deadline = Deadline(params.budget);
+    tt.fCancelled = false;
+    tt.Optimize();
+    vLevels = tt.vLevels;
+    if(tt.fCancelled) {
+      status = 2;
+      if(k == 0) {
+        WriteCover(onsets, inputs, outputs, f);
+      }
+      continue;
+    }
+    std::stringstream ss;
+    vNodes[k] = tt.BDDGenerateBlif(inputs, outputs, ss);
+    if(k == 0) {
+      f << ss.str();
+    }
+  }
+  std::unique_lock<std::mutex> lock(ctx.pSweep->mtx);
+  for(int k = 0; k < nRarities; k++) {
+    ctx.pSweep->vNodes[k] += vNodes[k];
+  }
+  return status;
+}
+
+void TTTest(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &pBPats, int nBPats, PatternCounter const *pCount, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f, Params const &params, Context const &ctx) {
+  std::stringstream ss;
+  std::ostream &out = ctx.pVerify? ss: f;
+  int status;
+  if(ctx.pSweep && (nBPats || pCount)) {
+    status = RaritySweep(onsets, pBPats, nBPats, pCount, inputs, outputs, out, params, ctx);
+    rarity = params.vRarities[0];
+  } else {
+    status = OptimizeGroupCached(onsets, pBPats, nBPats, pCount, rarity, inputs, outputs, out, params, ctx);
+  }
+  if(status && ctx.pBudget) {
+    std::unique_lock<std::mutex> lock(ctx.pBudget->mtx);
+    ctx.pBudget->vFallbacks.push_back(outputs.front() + (status == 1? " order": " cover"));
+  }
+  if(ctx.pVerify) {
+    if(pCount) {
+      // checked when the sim is streamed again at the end of the layer
+      std::unique_lock<std::mutex> lock(ctx.pVerify->mtx);
+      ctx.pVerify->vDeferred.emplace_back(new GroupVerifier(ss.str(), onsets, inputs, outputs));
+    } else {
+      VerifyGroup(ss.str(), onsets, pBPats, nBPats, rarity, inputs, outputs, ctx.pPool, ctx.pVerify);
+    }
+    f << ss.str();
+  }
+}
+
+void SetCareCache(CareCache *pCareCache) {
+  TruthTableCare::pCareCache = pCareCache;
+}
+
+void SetOrderDatabase(OrderDatabase *pOrders) {
+  pOrderDatabase = pOrders;
+}
@@ -0,0 +1,288 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <climits>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <algorithm>
+
+#include "ThreadPool.h"
+#include "Verify.h"
+#include "PatternSource.h"
+
+typedef GroupVerifier::word word;
+
+// only the mismatching patterns are counted, usually few, so the counter starts sparse and is not capped
+GroupVerifier::Mismatches::Mismatches(int nInputs, int nOutputs, int nTableWords): count(nInputs, 0, INT_MAX), diff(nOutputs, std::vector<word>(nTableWords)) {}
+
+void GroupVerifier::Mismatches::Merge(Mismatches const &other) {
+  other.count.ForEach([&](int pat, int n) {
+    count.Add(pat, n);
+  });
+  for(unsigned o = 0; o < diff.size(); o++) {
+    for(unsigned j = 0; j < diff[o].size(); j++) {
+      diff[o][j] |= other.diff[o][j];
+    }
+  }
+}
+
+GroupVerifier::GroupVerifier(std::string const &blif, std::vector<std::vector<int> > const &onsets, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs): inputs(inputs), nInputs(inputs.size()), nOutputs(outputs.size()), nTableWords(((1ll << nInputs) + 63) / 64), outputs(outputs), nPatterns(0), total(nInputs, nOutputs, nTableWords) {
+  ParseNames(blif, inputs);
+  vvOrig.assign(nOutputs, std::vector<word>(nTableWords));
+  for(int o = 0; o < nOutputs; o++) {
+    for(int pat: onsets[o]) {
+      vvOrig[o][pat >> 6] |= 1ull << (pat & 63);
+    }
+  }
+  // the slices of whole words, from single words up
+  int nUpper = std::max(0, nInputs - 6);
+  word full = nInputs >= 6? ~0ull: (1ull << (1 << nInputs)) - 1;
+  vvvSlices.resize(nOutputs);
+  for(int o = 0; o < nOutputs; o++) {
+    auto &vvSlices = vvvSlices[o];
+    vvSlices.resize(nUpper + 1);
+    vvSlices[nUpper].resize(nTableWords);
+    for(int j = 0; j < nTableWords; j++) {
+      word t = vvOrig[o][j];
+      vvSlices[nUpper][j] = !t? 0: t == full? 1: 2;
+    }
+    for(int i = nUpper - 1; i >= 0; i--) {
+      vvSlices[i].resize(1 << i);
+      for(int j = 0; j < (1 << i); j++) {
+        char lo = vvSlices[i + 1][2 * j], hi = vvSlices[i + 1][2 * j + 1];
+        vvSlices[i][j] = lo == hi? lo: 2;
+      }
+    }
+  }
+}
+
+// signals 0 to nInputs-1 are the group inputs and node i is signal nInputs+i
+void GroupVerifier::ParseNames(std::string const &blif, std::vector<std::string> const &inputs) {
+  std::map<std::string, int> signals;
+  for(unsigned i = 0; i < inputs.size(); i++) {
+    signals[inputs[i]] = i;
+  }
+  std::stringstream ss(blif);
+  std::string line;
+  while(std::getline(ss, line)) {
+    std::stringstream ls(line);
+    std::string token;
+    if(!(ls >> token)) {
+      continue;
+    }
+    if(token == ".names") {
+      std::vector<std::string> names;
+      while(ls >> token) {
+        names.push_back(token);
+      }
+      Node node;
+      for(unsigned j = 0; j + 1 < names.size(); j++) {
+        auto it = signals.find(names[j]);
+        if(it == signals.end()) {
+          throw std::runtime_error("verify: undefined signal " + names[j]);
+        }
+        node.fanins.push_back(it->second);
+      }
+      nodes.push_back(node);
+      signals[names.back()] = inputs.size() + nodes.size() - 1;
+      continue;
+    }
+    if(token[0] != '0' && token[0] != '1' && token[0] != '-') {
+      continue;
+    }
+    Node &node = nodes.back();
+    std::string cube, out;
+    if(node.fanins.empty()) {
+      out = token;
+    } else {
+      cube = token;
+      ls >> out;
+    }
+    node.fOffset = out == "0";
+    node.cubes.push_back(cube);
+  }
+  vOutputSigs.resize(nOutputs);
+  for(int o = 0; o < nOutputs; o++) {
+    auto it = signals.find(outputs[o]);
+    if(it == signals.end()) {
+      throw std::runtime_error("verify: output " + outputs[o] + " is not driven");
+    }
+    vOutputSigs[o] = it->second;
+  }
+}
+
+// simulates 64 patterns per word, vSigs holds the words of the inputs on entry and of all signals on return
+void GroupVerifier::Simulate(std::vector<word> &vSigs) const {
+  for(auto const &node: nodes) {
+    word r = 0;
+    for(auto const &cube: node.cubes) {
+      word c = ~0ull;
+      for(unsigned j = 0; j < cube.size(); j++) {
+        if(cube[j] == '1') {
+          c &= vSigs[node.fanins[j]];
+        } else if(cube[j] == '0') {
+          c &= ~vSigs[node.fanins[j]];
+        }
+      }
+      r |= c;
+    }
+    vSigs.push_back(node.fOffset? ~r: r);
+  }
+}
+
+// the value of output o on the patterns of m, which agree with minterm base on inputs 0 to i-1
+// the patterns are split by input until the slice of the table they fall in is constant
+word GroupVerifier::Eval(int o, int i, long long base, word m, std::vector<word> const &vSigs) const {
+  if(!m) {
+    return 0;
+  }
+  int nSize = nInputs - i;
+  char slice;
+  if(nSize > 6) {
+    slice = vvvSlices[o][i][base >> nSize];
+  } else {
+    word mask = nSize == 6? ~0ull: (1ull << (1 << nSize)) - 1;
+    word bits = (vvOrig[o][base >> 6] >> (base & 63)) & mask;
+    slice = !bits? 0: bits == mask? 1: 2;
+  }
+  if(slice != 2) {
+    return slice? m: 0;
+  }
+  return Eval(o, i + 1, base, m & ~vSigs[i], vSigs) | Eval(o, i + 1, base + (1ll << (nSize - 1)), m & vSigs[i], vSigs);
+}
+
+// the words [begin, end) of the patterns
+void GroupVerifier::CheckWords(std::vector<char *> const &pBPats, bool fMinterms, long long nPatterns, long long begin, long long end, Mismatches &mis) const {
+  // the last 6 inputs over the 64 minterms of a word
+  static const word pMinterms[6] = {0xaaaaaaaaaaaaaaaaull, 0xccccccccccccccccull, 0xf0f0f0f0f0f0f0f0ull, 0xff00ff00ff00ff00ull, 0xffff0000ffff0000ull, 0xffffffff00000000ull};
+  std::vector<word> vSigs;
+  std::vector<word> vDiffs(nOutputs);
+  for(long long w = begin; w < end; w++) {
+    vSigs.assign(nInputs, 0);
+    int nValid = std::min(64ll, nPatterns - 64 * w);
+    word valid = nValid == 64? ~0ull: (1ull << nValid) - 1;
+    for(int i = 0; i < nInputs; i++) {
+      int b = nInputs - 1 - i;
+      if(!fMinterms) {
+        // bit j of byte b is pattern 8b+j, as in the care computation
+        memcpy(&vSigs[i], pBPats[i] + 8 * w, nValid / 8 + (nValid % 8 != 0));
+      } else if(b < 6) {
+        vSigs[i] = pMinterms[b];
+      } else {
+        vSigs[i] = (w >> (b - 6)) & 1? ~0ull: 0;
+      }
+    }
+    Simulate(vSigs);
+    word any = 0;
+    for(int o = 0; o < nOutputs; o++) {
+      // without patterns the word is that of the table
+      word orig = fMinterms? vvOrig[o][w]: Eval(o, 0, 0, valid, vSigs);
+      vDiffs[o] = (vSigs[vOutputSigs[o]] ^ orig) & valid;
+      any |= vDiffs[o];
+    }
+    for(; any; any &= any - 1) {
+      int k = __builtin_ctzll(any);
+      int pat = 0;
+      for(int i = 0; i < nInputs; i++) {
+        pat = (pat << 1) | ((vSigs[i] >> k) & 1);
+      }
+      mis.count.Add(pat);
+      for(int o = 0; o < nOutputs; o++) {
+        if((vDiffs[o] >> k) & 1) {
+          mis.diff[o][pat >> 6] |= 1ull << (pat & 63);
+        }
+      }
+    }
+  }
+}
+
+void GroupVerifier::Check(std::vector<char *> const &pBPats, long long nPatterns, ThreadPool *pPool) {
+  bool fMinterms = !nPatterns;
+  if(fMinterms) {
+    nPatterns = 1ll << nInputs;
+  }
+  this->nPatterns += nPatterns;
+  long long nWords = (nPatterns + 63) / 64;
+  int nParts = 1;
+  if(pPool && nWords >= 1024) {
+    nParts = std::max(1, pPool->NumThreads());
+  }
+  if(nParts == 1) {
+    CheckWords(pBPats, fMinterms, nPatterns, 0, nWords, total);
+    return;
+  }
+  std::vector<Mismatches> parts(nParts, Mismatches(nInputs, nOutputs, nTableWords));
+  std::atomic<int> nPending(0);
+  for(int i = 0; i < nParts; i++) {
+    pPool->Submit([&, i]() { CheckWords(pBPats, fMinterms, nPatterns, nWords * i / nParts, nWords * (i + 1) / nParts, parts[i]); }, nPending);
+  }
+  pPool->Wait(nPending);
+  for(auto const &part: parts) {
+    total.Merge(part);
+  }
+}
+
+void GroupVerifier::Report(int rarity, bool fPatterns, VerifyStats *pStats) {
+  std::stringstream ss;
+  for(int o = 0; o < nOutputs; o++) {
+    long long nCare = 0, nDc = 0;
+    for(int j = 0; j < nTableWords; j++) {
+      for(word d = total.diff[o][j]; d; d &= d - 1) {
+        int pat = (j << 6) + __builtin_ctzll(d);
+        int n = total.count.Get(pat);
+        if(fPatterns && n >= rarity) {
+          nCare += n;
+        } else {
+          nDc += n;
+        }
+      }
+    }
+    if(nCare || nDc) {
+      ss << "verify " << outputs[o] << " care " << nCare << " dc " << nDc << std::endl;
+    }
+    if(pStats) {
+      pStats->nCareMismatches += nCare;
+      pStats->nDcMismatches += nDc;
+    }
+  }
+  if(pStats) {
+    pStats->nPatterns += nPatterns;
+    pStats->nOutputs += nOutputs;
+  }
+  std::cout << ss.str();
+}
+
+// simulates the BLIF emitted for a group and compares it with the onsets on the patterns
+void VerifyGroup(std::string const &blif, std::vector<std::vector<int> > const &onsets, std::vector<char *> const &pBPats, int nBPats, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, ThreadPool *pPool, VerifyStats *pStats) {
+  GroupVerifier verifier(blif, onsets, inputs, outputs);
+  verifier.Check(pBPats, 8ll * nBPats, pPool);
+  verifier.Report(rarity, nBPats, pStats);
+}
+
+void VerifyDeferred(PatternSource &source, std::map<std::string, int> const &input2index, int rarity, ThreadPool *pPool, VerifyStats &stats) {
+  std::vector<std::vector<int> > vvInputs;
+  for(auto const &pVerifier: stats.vDeferred) {
+    vvInputs.emplace_back();
+    for(auto const &input: pVerifier->inputs) {
+      vvInputs.back().push_back(input2index.at(input));
+    }
+  }
+  std::vector<char *> vpBPats, pBPats;
+  int nBytes, nValid;
+  while(source.Next(vpBPats, nBytes, nValid)) {
+    for(unsigned g = 0; g < stats.vDeferred.size(); g++) {
+      pBPats.clear();
+      for(int input: vvInputs[g]) {
+        pBPats.push_back(vpBPats[input]);
+      }
+      stats.vDeferred[g]->Check(pBPats, nValid, pPool);
+    }
+  }
+  for(auto const &pVerifier: stats.vDeferred) {
+    pVerifier->Report(rarity, true, &stats);
+  }
+  stats.vDeferred.clear();
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "PatternCounter.h"
+
+class ThreadPool;
+class PatternSource;
+struct VerifyStats;
+
+// checks the BLIF emitted for a group against its onsets, on patterns given in one or more batches
+// both are simulated 64 patterns per word, and only the mismatching patterns are looked at one by one
+class GroupVerifier {
+public:
+  typedef uint64_t word;
+
+  std::vector<std::string> inputs;
+
+  GroupVerifier(std::string const &blif, std::vector<std::vector<int> > const &onsets, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs);
+
+  // simulates nPatterns patterns of the columns pBPats, in parts on the pool if any
+  // with nPatterns 0 every minterm is simulated once instead
+  void Check(std::vector<char *> const &pBPats, long long nPatterns, ThreadPool *pPool);
+
+  // prints the mismatches of every output, separately on care patterns and on patterns rarer than rarity,
+  // and adds them to pStats if not NULL
+  // without patterns all minterms are don't cares as in the optimizer
+  void Report(int rarity, bool fPatterns, VerifyStats *pStats);
+
+private:
+  struct Node {
+    std::vector<int> fanins;
+    std::vector<std::string> cubes;
+    bool fOffset = false;
+  };
+
+  // mismatches of a batch or of a part of it, merged afterwards
+  struct Mismatches {
+    PatternCounter count;
+    std::vector<std::vector<word> > diff;
+    Mismatches(int nInputs, int nOutputs, int nTableWords);
+    void Merge(Mismatches const &other);
+  };
+
+  int nInputs;
+  int nOutputs;
+  int nTableWords;
+  std::vector<std::string> outputs;
+  std::vector<Node> nodes;
+  std::vector<int> vOutputSigs;
+  std::vector<std::vector<word> > vvOrig;
+  // per output and input i above the last 6, whether each slice of the table fixed by inputs 0 to i-1 is 0, 1 or mixed
+  std::vector<std::vector<std::vector<char> > > vvvSlices;
+  long long nPatterns;
+  Mismatches total;
+
+  void ParseNames(std::string const &blif, std::vector<std::string> const &inputs);
+  void Simulate(std::vector<word> &vSigs) const;
+  word Eval(int o, int i, long long base, word m, std::vector<word> const &vSigs) const;
+  void CheckWords(std::vector<char *> const &pBPats, bool fMinterms, long long nPatterns, long long begin, long long end, Mismatches &mis) const;
+};
+
+// totals of the verification of the groups of a layer
+// a care mismatch is a pattern seen at least rarity times on which the result differs from the onsets, that is a bug
+// a dc mismatch is a rarer pattern on which it differs, the error introduced by treating it as don't care
+struct VerifyStats {
+  std::atomic<long long> nPatterns{0};
+  std::atomic<long long> nOutputs{0};
+  std::atomic<long long> nCareMismatches{0};
+  std::atomic<long long> nDcMismatches{0};
+  // groups whose patterns are streamed, checked in one more pass over the sim at the end of the layer
+  std::mutex mtx;
+  std::vector<std::unique_ptr<GroupVerifier> > vDeferred;
+};
+
+// checks the deferred groups of stats in one pass over source and reports them, input2index maps the names of the inputs to the columns of source
+void VerifyDeferred(PatternSource &source, std::map<std::string, int> const &input2index, int rarity, ThreadPool *pPool, VerifyStats &stats);
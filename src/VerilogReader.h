@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+// reads a layer written as dirname/layer{id}.v, which wires the layer inputs to the LUTs,
+// and dirname/layer{id}_N{k}.v, the case table of LUT k, in the format conv.py reads
+// the case tables are parsed ahead on worker threads and returned in order by ReadFuncs
+class VerilogReader {
+public:
+  std::string modulename;
+  std::vector<std::string> inputs;
+  std::vector<std::string> outputs;
+
+  VerilogReader(std::string const &dirname, std::string const &layerid, int nThreads, int nWindow = 64);
+  ~VerilogReader();
+
+  // same as ReadBlifFuncs, a group is a LUT with all its outputs
+  int ReadFuncs(std::vector<std::string> &LUTInputs, std::vector<std::string> &LUTOutputs, std::vector<std::vector<int> > &onsets);
+
+private:
+  std::string prefix;
+  int nWindow;
+  std::vector<std::vector<std::string> > vvLUTInputs;
+  std::vector<std::vector<std::vector<int> > > vvvOnsets;
+  std::vector<char> vReady;
+  // the failure of reading a case table, rethrown to the consumer when it gets there
+  std::vector<std::exception_ptr> vErrors;
+  int iNext;
+  int iClaim;
+  int nOutputsRead;
+  bool fStop;
+  std::vector<std::thread> vThreads;
+  std::mutex mtx;
+  std::condition_variable cv;
+
+  void ReadLayer(std::string const &filename);
+  void Worker();
+};
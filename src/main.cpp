@@ -6,18 +6,51 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <cassert>
+#include <memory>
+#include <filesystem>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "Params.h"
+#include "Group.h"
+#include "ThreadPool.h"
+#include "Context.h"
+#include "Cache.h"
+#include "OrderHints.h"
+#include "CareCache.h"
+#include "OrderDatabase.h"
+#include "VerilogReader.h"
+#include "Verify.h"
+#include "PatternSource.h"
+#include "PatternCounter.h"
 
 extern void ReadBlifHeader(std::ifstream &f, std::string &modulename, std::vector<std::string> &inputs, std::vector<std::string> &outputs);
-extern void ReadSim(std::string filename, int nInputs, std::vector<char *> &vpBPats, int &nBpatterns);
-extern int ReadBlifFuncs(std::ifstream &f, int nGroupSize, std::vector<std::string> &LUTInputs, std::vector<std::string> &LUTOutputs, std::vector<std::vector<int> > &onsets);
+extern void MapSim(std::string filename, int nInputs, std::vector<char *> &vpBPats, int &nBPats);
+extern int ReleaseStaleSims();
+extern void WriteSimPacked(std::string filename, std::vector<char *> const &vpBPats, int nBPats);
+extern void CountGroupPatterns(PatternSource &source, std::vector<std::vector<int> > const &vvInputs, std::vector<PatternCounter> &counters);
+extern int ReadBlifFuncs(std::istream &f, int nGroupSize, std::vector<std::string> &LUTInputs, std::vector<std::string> &LUTOutputs, std::vector<std::vector<int> > &onsets);
 extern void GeneratePla(std::string filename, std::vector<std::vector<int> > const &onsets, std::vector<char *> const &vpBPats, int nBPats, int rarity);
 extern void ReadPla(std::string filename, std::vector<std::vector<std::string> > &onsets);
 
-extern void TTTest(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &vpBPats, int nBPats, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ofstream &f);
+extern void TTTest(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &vpBPats, int nBPats, PatternCounter const *pCount, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f, Params const &params, Context const &ctx);
+extern void RunGroups(std::vector<Group> const &groups, int rarity, std::ostream &f, Params const &params, Context const &ctx);
+extern int StrashBlif(std::string const &blif, std::vector<std::string> const &outputs, std::ostream &f, int &nNodes);
+extern bool CheckStrategy(std::string const &strategy);
+extern void SetCareCache(CareCache *pCareCache);
+extern void SetOrderDatabase(OrderDatabase *pOrders);
+extern int Serve(std::string sockname, std::function<int(std::string const &kind, std::vector<std::string> const &args, std::string const &body, std::ostream &out)> Job);
 
-void RunEspresso(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &vpBPats, int nBPats, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ofstream &f) {
-  std::string planame = "test.pla";
+void RunEspresso(std::vector<std::vector<int> > const &onsets, std::vector<char *> const &vpBPats, int nBPats, int rarity, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, std::ostream &f) {
+  // named per process and call, so that concurrent runs do not share the files
+  static std::atomic<int> nCalls(0);
+  std::string planame = "test" + std::to_string(getpid()) + "_" + std::to_string(nCalls++) + ".pla";
   GeneratePla(planame, onsets, vpBPats, nBPats, rarity);
   std::string planame2 = planame + ".esp.pla";
   std::string cmd = "espresso " + planame + " > " + planame2;
@@ -25,6 +58,8 @@ void RunEspresso(std::vector<std::vector<int> > const &onsets, std::vector<char
   assert(r == 0);
   std::vector<std::vector<std::string> > onsets2;
   ReadPla(planame2, onsets2);
+  std::remove(planame.c_str());
+  std::remove(planame2.c_str());
   for(uint i = 0; i < outputs.size(); i++) {
     f << ".names";
     for(auto input: inputs) {
@@ -37,25 +72,58 @@ void RunEspresso(std::vector<std::vector<int> > const &onsets, std::vector<char
   }
 }
 
-int main(int argc, char **argv) {
-  std::string ifname = argv[1];
-  std::string ofname = ifname + ".opt.blif";
-  int nGroupSize  = 3;
-  std::string simname;
-  if(argc > 2) {
-    simname = argv[2];
-  }
+void Usage(char *name) {
+  std::cerr << "usage: " << name << " [-p strategies] [-n rounds] [-w] [-G] [-B] [-x] [-j threads] [-c dir] [-C megabytes] [-o] [-V] [-R rarities] [-s kilobytes] [-P packed] [-t seconds] [-m megabytes] [-H] [-D orders] <blif> [sim]" << std::endl;
+  std::cerr << "       " << name << " [options] -v layerid <dir> [sim]" << std::endl;
+  std::cerr << "       " << name << " [options] -b <dir|manifest>" << std::endl;
+  std::cerr << "       " << name << " [-j threads] [-c dir] [-C megabytes] -L <socket>" << std::endl;
+  std::cerr << "  -p : comma-separated strategies run concurrently per group, keeping the smallest result" << std::endl;
+  std::cerr << "       a strategy is an engine, or \"sifter+engine\" to apply the order found by the sifter" << std::endl;
+  std::cerr << "       engines: bdd reo care carereduce osdm osm osm-nocompl tsm tsm-nocompl levtsm carereo" << std::endl;
+  std::cerr << "  -n : number of random sifting rounds [default = 20]" << std::endl;
+  std::cerr << "  -w : start sifting from the order found for an earlier group sharing at least half of the inputs" << std::endl;
+  std::cerr << "  -G : reorder groups of 10 inputs or more by crossing, annealing and sifting orders on one island per thread," << std::endl;
+  std::cerr << "       exchanging the best order between generations, in about the swaps of the rounds of -n" << std::endl;
+  std::cerr << "  -B : with -j, sift the rounds of a group one after another, each variable downward and upward on two threads," << std::endl;
+  std::cerr << "       for the same orders as without -j at a lower latency than one thread" << std::endl;
+  std::cerr << "  -x : reorder groups of up to 5 inputs, or 6 with one output, by trying all orders instead of sifting," << std::endl;
+  std::cerr << "       never larger under the same count, and usually faster, but the orders and so the results differ" << std::endl;
+  std::cerr << "  -j : optimize groups on a pool of this many threads, most expensive first [default = 0]" << std::endl;
+  std::cerr << "  -c : directory of a persistent result cache, groups found in it are not optimized again" << std::endl;
+  std::cerr << "  -C : size limit of the cache, least recently used entries are evicted [default = 1024]" << std::endl;
+  std::cerr << "  -o : cache only the variable orders, not the BLIF" << std::endl;
+  std::cerr << "  -V : simulate every optimized group on the patterns and report mismatches with the original" << std::endl;
+  std::cerr << "  -R : comma-separated rarity thresholds, each group is optimized for all of them from one pattern count" << std::endl;
+  std::cerr << "       node counts are reported per threshold, the result of the first one is written" << std::endl;
+  std::cerr << "       each threshold gets the budgets of -t and -m, and those written as the cover are left out of the counts" << std::endl;
+  std::cerr << "  -s : stream the sim in slabs of this many kilobytes per input instead of mapping it whole" << std::endl;
+  std::cerr << "       sims in the packed format are always streamed" << std::endl;
+  std::cerr << "  -P : write the sim in the packed format, which records the numbers of inputs and patterns, and exit" << std::endl;
+  std::cerr << "  -t : time budget per group, a search running over it keeps its best order so far," << std::endl;
+  std::cerr << "       and an Optimize running over as much again writes the original cover, the groups are listed per layer" << std::endl;
+  std::cerr << "  -m : memory budget per group, groups whose tables would not fit are written as their original cover" << std::endl;
+  std::cerr << "  -H : merge the nodes computing the same function of the same fanins across the groups of a layer," << std::endl;
+  std::cerr << "       and drop the per-group constants and input buffers" << std::endl;
+  std::cerr << "  -D : with -x, file of the best orders of groups of up to 5 inputs, or 6 with one output, by class under input permutation," << std::endl;
+  std::cerr << "       read at start and written back with the classes found, they are otherwise kept for the run only" << std::endl;
+  std::cerr << "  -v : read dir/layer<layerid>.v and its case tables dir/layer<layerid>_N<k>.v instead of a BLIF" << std::endl;
+  std::cerr << "  -b : optimize every BLIF of a directory, paired with the sim of the same name if any," << std::endl;
+  std::cerr << "       or of a manifest listing \"blif [sim]\" per line, in one process" << std::endl;
+  std::cerr << "  -L : serve the command lines sent by ttclient on this Unix socket, keeping the pool, caches and sims" << std::endl;
+  std::cerr << "       of the server across them, their own -j, -c, -C and -D are ignored, the orders of the -D of the server are used" << std::endl;
+}
+
+typedef std::function<int(std::vector<std::string> &, std::vector<std::string> &, std::vector<std::vector<int> > &)> ReadFuncs;
+
+// optimizes the groups given by Read until it returns 0 and writes the layer into ofname, returns the number of groups
+int OptimizeLayer(std::string modulename, std::vector<std::string> const &inputs, std::vector<std::string> const &outputs, ReadFuncs Read, std::string simname, std::string ofname, Params const &params, Context const &ctx) {
   int rarity = 1;
   if(simname.empty()) {
     rarity = 0;
   }
 
-  std::ifstream f(ifname);
   std::ofstream of(ofname);
 
-  std::string modulename;
-  std::vector<std::string> inputs, outputs;
-  ReadBlifHeader(f, modulename, inputs, outputs);
   int nInputs = inputs.size();
   std::map<std::string, int> input2index;
   for(uint i = 0; i < inputs.size(); i++) {
@@ -74,33 +142,476 @@ int main(int argc, char **argv) {
   }
   of << std::endl;
 
+  // the groups go through the structural hashing at the end if it is on
+  std::stringstream body;
+  std::ostream &out = params.fStrash? (std::ostream &)body: of;
+
+  // streamed patterns are only counted, and each group gets its care from its counts
+  bool fStream = !simname.empty() && (params.nSlabBytes || PatternSource::IsPacked(simname));
   std::vector<char *> vpBPats;
-  int nBPats;
-  if(!simname.empty()) {
-    ReadSim(simname, nInputs, vpBPats, nBPats);
+  int nBPats = 0;
+  if(!simname.empty() && !fStream) {
+    MapSim(simname, nInputs, vpBPats, nBPats);
   }
 
   std::vector<std::string> LUTInputs;
   std::vector<std::string> LUTOutputs;
   std::vector<std::vector<int> > onsets;
-  while(ReadBlifFuncs(f, nGroupSize, LUTInputs, LUTOutputs, onsets)) {
+  std::vector<Group> groups;
+  int nGroups = 0;
+  while(Read(LUTInputs, LUTOutputs, onsets)) {
+    nGroups++;
     std::vector<char *> vpBPatsSubset(LUTInputs.size());
-    if(!simname.empty()) {
+    if(!simname.empty() && !fStream) {
       for(uint i = 0; i < LUTInputs.size(); i++) {
         vpBPatsSubset[i] = vpBPats[input2index[LUTInputs[i]]];
       }
     }
 
-    TTTest(onsets, vpBPatsSubset, nBPats, rarity, LUTInputs, LUTOutputs, of);
+    if(ctx.pPool || fStream) {
+      groups.push_back({LUTInputs, LUTOutputs, onsets, vpBPatsSubset, nBPats});
+      continue;
+    }
+    TTTest(onsets, vpBPatsSubset, nBPats, NULL, rarity, LUTInputs, LUTOutputs, out, params, ctx);
     //RunEspresso(onsets, vpBPatsSubset, nBPats, rarity, LUTInputs, LUTOutputs, of);
   }
+  std::vector<PatternCounter> counters;
+  if(fStream) {
+    int nCap = rarity;
+    for(int r: params.vRarities) {
+      nCap = std::max(nCap, r);
+    }
+    PatternSource source(simname, nInputs, params.nSlabBytes? params.nSlabBytes: 1 << 20);
+    std::vector<std::vector<int> > vvInputs;
+    for(auto &group: groups) {
+      vvInputs.emplace_back();
+      for(auto const &input: group.inputs) {
+        vvInputs.back().push_back(input2index[input]);
+      }
+      counters.emplace_back(group.inputs.size(), source.nPatterns, nCap);
+      group.vpBPats.clear();
+    }
+    CountGroupPatterns(source, vvInputs, counters);
+    for(uint i = 0; i < groups.size(); i++) {
+      groups[i].pCount = &counters[i];
+    }
+    nBPats = source.nPatterns / 8;
+  }
+  if(ctx.pPool) {
+    RunGroups(groups, rarity, out, params, ctx);
+  } else {
+    for(auto const &group: groups) {
+      TTTest(group.onsets, group.vpBPats, group.nBPats, group.pCount, rarity, group.inputs, group.outputs, out, params, ctx);
+    }
+  }
+  if(fStream && ctx.pVerify) {
+    PatternSource source(simname, nInputs, params.nSlabBytes? params.nSlabBytes: 1 << 20);
+    VerifyDeferred(source, input2index, ctx.pSweep? params.vRarities[0]: rarity, ctx.pPool, *ctx.pVerify);
+  }
 
+  if(params.fStrash) {
+    int nNodes = 0;
+    int nWritten = StrashBlif(body.str(), outputs, of, nNodes);
+    std::cout << "strash " << ofname << " names " << nNodes << " -> " << nWritten << std::endl;
+  }
   of << ".end" << std::endl;
+  if(ctx.pSweep && nBPats) {
+    for(uint k = 0; k < params.vRarities.size(); k++) {
+      std::cout << "sweep " << ofname << " rarity " << params.vRarities[k] << " nodes " << ctx.pSweep->vNodes[k] << std::endl;
+      ctx.pSweep->vNodes[k] = 0;
+    }
+  }
+  if(ctx.pBudget) {
+    std::sort(ctx.pBudget->vFallbacks.begin(), ctx.pBudget->vFallbacks.end());
+    for(auto const &fallback: ctx.pBudget->vFallbacks) {
+      std::cout << "budget " << ofname << " fallback " << fallback << std::endl;
+    }
+    std::cout << "budget " << ofname << " fallbacks " << ctx.pBudget->vFallbacks.size() << std::endl;
+    ctx.pBudget->vFallbacks.clear();
+  }
+  if(ctx.pVerify) {
+    VerifyStats &stats = *ctx.pVerify;
+    std::cout << "verify " << ofname << " patterns " << stats.nPatterns << " outputs " << stats.nOutputs << " care " << stats.nCareMismatches << " dc " << stats.nDcMismatches << std::endl;
+    stats.nPatterns = stats.nOutputs = stats.nCareMismatches = stats.nDcMismatches = 0;
+  }
+  return nGroups;
+}
 
-  for(auto pBPats: vpBPats) {
-    free(pBPats);
+// optimizes the groups of a BLIF into ifname.opt.blif
+int OptimizeBlif(std::string ifname, std::string simname, Params const &params, Context const &ctx) {
+  int nGroupSize  = 3;
+  std::ifstream f(ifname);
+  if(!f) {
+    std::cerr << "cannot open " << ifname << std::endl;
+    return 0;
   }
-  vpBPats.clear();
+  std::string modulename;
+  std::vector<std::string> inputs, outputs;
+  ReadBlifHeader(f, modulename, inputs, outputs);
+  return OptimizeLayer(modulename, inputs, outputs, [&](std::vector<std::string> &LUTInputs, std::vector<std::string> &LUTOutputs, std::vector<std::vector<int> > &onsets) {
+    return ReadBlifFuncs(f, nGroupSize, LUTInputs, LUTOutputs, onsets);
+  }, simname, ifname + ".opt.blif", params, ctx);
+}
 
+// optimizes the case tables of dirname/layer{id}*.v into layer{id}.blif.opt.blif, the name the BLIF from conv.py would get
+int OptimizeVerilog(std::string dirname, std::string layerid, std::string simname, Params const &params, Context const &ctx) {
+  VerilogReader reader(dirname, layerid, std::thread::hardware_concurrency());
+  return OptimizeLayer(reader.modulename, reader.inputs, reader.outputs, [&](std::vector<std::string> &LUTInputs, std::vector<std::string> &LUTOutputs, std::vector<std::vector<int> > &onsets) {
+    return reader.ReadFuncs(LUTInputs, LUTOutputs, onsets);
+  }, simname, "layer" + layerid + ".blif.opt.blif", params, ctx);
+}
+
+// optimizes the LUTs given as .names in names, consecutive ones with the same inputs being a group, and writes their .names into f
+// their inputs are looked up in the header of blifname to find the columns of the sim
+int OptimizeNames(std::string const &names, std::string blifname, std::string simname, Params const &params, Context const &ctx, std::ostream &f) {
+  std::ifstream bf(blifname);
+  if(!bf) {
+    std::cerr << "cannot open " << blifname << std::endl;
+    return 1;
+  }
+  std::string modulename;
+  std::vector<std::string> inputs, outputs;
+  ReadBlifHeader(bf, modulename, inputs, outputs);
+  std::map<std::string, int> input2index;
+  for(uint i = 0; i < inputs.size(); i++) {
+    input2index[inputs[i]] = i;
+  }
+  int rarity = simname.empty()? 0: 1;
+  std::vector<char *> vpBPats;
+  int nBPats = 0;
+  if(!simname.empty()) {
+    MapSim(simname, inputs.size(), vpBPats, nBPats);
+  }
+  std::stringstream ss(names);
+  std::vector<Group> groups;
+  std::vector<std::string> LUTInputs;
+  std::vector<std::string> LUTOutputs;
+  std::vector<std::vector<int> > onsets;
+  while(ReadBlifFuncs(ss, 1, LUTInputs, LUTOutputs, onsets)) {
+    if(!groups.empty() && groups.back().inputs == LUTInputs) {
+      groups.back().outputs.push_back(LUTOutputs[0]);
+      groups.back().onsets.push_back(onsets[0]);
+      continue;
+    }
+    std::vector<char *> vpBPatsSubset(LUTInputs.size());
+    for(uint i = 0; i < LUTInputs.size(); i++) {
+      if(!input2index.count(LUTInputs[i])) {
+        std::cerr << "unknown input " << LUTInputs[i] << std::endl;
+        return 1;
+      }
+      if(!simname.empty()) {
+        vpBPatsSubset[i] = vpBPats[input2index[LUTInputs[i]]];
+      }
+    }
+    groups.push_back({LUTInputs, LUTOutputs, onsets, vpBPatsSubset, nBPats});
+  }
+  for(auto const &group: groups) {
+    TTTest(group.onsets, group.vpBPats, group.nBPats, group.pCount, rarity, group.inputs, group.outputs, f, params, ctx);
+  }
   return 0;
 }
+
+// pairs of BLIF and sim names, the sim is empty if there is none
+std::vector<std::pair<std::string, std::string> > ReadBatch(std::string name) {
+  std::vector<std::pair<std::string, std::string> > files;
+  if(std::filesystem::is_directory(name)) {
+    for(auto const &entry: std::filesystem::directory_iterator(name)) {
+      std::filesystem::path path = entry.path();
+      if(path.extension() != ".blif" || path.stem().extension() == ".opt") {
+        continue;
+      }
+      std::filesystem::path simpath = path;
+      simpath.replace_extension(".sim");
+      files.push_back({path.string(), std::filesystem::exists(simpath)? simpath.string(): ""});
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+  }
+  std::ifstream f(name);
+  if(!f) {
+    std::cerr << "cannot open " << name << std::endl;
+    return files;
+  }
+  std::string line;
+  while(std::getline(f, line)) {
+    std::stringstream ss(line);
+    std::string blifname, simname;
+    ss >> blifname >> simname;
+    if(blifname.empty() || blifname[0] == '#') {
+      continue;
+    }
+    files.push_back({blifname, simname});
+  }
+  return files;
+}
+
+// parses the options into params and the modes, optind is left at the first argument
+bool ParseArgs(int argc, char **argv, Params &params, std::string &batchname, std::string &layerid, std::string &packedname, std::string &socketname) {
+  int c;
+  // restarts the scan, options are parsed again for every job of the server
+  optind = 0;
+  while((c = getopt(argc, argv, "p:n:wGBxj:c:C:ob:v:VR:s:P:L:t:m:HD:h")) != -1) {
+    // numbers that do not parse fail the command line instead of the process, which may be a server
+    try {
+      switch(c) {
+      case 'p': {
+        std::stringstream ss(optarg);
+        std::string strategy;
+        while(std::getline(ss, strategy, ',')) {
+          if(!CheckStrategy(strategy)) {
+            std::cerr << "unknown strategy " << strategy << std::endl;
+            return false;
+          }
+          params.vStrategies.push_back(strategy);
+        }
+        break;
+      }
+      case 'n':
+        params.nRounds = std::stoi(optarg);
+        break;
+      case 'w':
+        params.fWarmStart = true;
+        break;
+      case 'G':
+        params.fPopulation = true;
+        break;
+      case 'B':
+        params.fBidirectional = true;
+        break;
+      case 'x':
+        params.fExhaustive = true;
+        break;
+      case 'j':
+        params.nThreads = std::stoi(optarg);
+        break;
+      case 'c':
+        params.cachename = optarg;
+        break;
+      case 'C':
+        params.nCacheBytes = std::stoll(optarg) << 20;
+        break;
+      case 'o':
+        params.fCacheBlif = false;
+        break;
+      case 'b':
+        batchname = optarg;
+        break;
+      case 'v':
+        layerid = optarg;
+        break;
+      case 'V':
+        params.fVerify = true;
+        break;
+      case 's':
+        params.nSlabBytes = std::stoi(optarg) << 10;
+        break;
+      case 'P':
+        packedname = optarg;
+        break;
+      case 'L':
+        socketname = optarg;
+        break;
+      case 'H':
+        params.fStrash = true;
+        break;
+      case 'D':
+        params.ordersname = optarg;
+        break;
+      case 't':
+        params.budget = std::stod(optarg);
+        break;
+      case 'm':
+        params.nBudgetBytes = std::stoll(optarg) << 20;
+        break;
+      case 'R': {
+        std::stringstream ss(optarg);
+        std::string rarity;
+        while(std::getline(ss, rarity, ',')) {
+          params.vRarities.push_back(std::stoi(rarity));
+          if(params.vRarities.back() < 1) {
+            std::cerr << "rarity must be positive" << std::endl;
+            return false;
+          }
+        }
+        break;
+      }
+      default:
+        Usage(argv[0]);
+        return false;
+      }
+    } catch(std::logic_error const &) {
+      std::cerr << "invalid argument " << optarg << " of -" << (char)c << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// runs one command line on the arguments after the options, with the pool and caches of ctx, returns the exit status
+int RunJob(Params const &params, std::string batchname, std::string layerid, std::string packedname, std::vector<std::string> const &args, Context ctx, char *name) {
+  if(batchname.empty() && args.empty()) {
+    Usage(name);
+    return 1;
+  }
+
+  if(!packedname.empty()) {
+    if(args.size() < 2) {
+      Usage(name);
+      return 1;
+    }
+    std::ifstream f(args[0]);
+    std::string modulename;
+    std::vector<std::string> inputs, outputs;
+    ReadBlifHeader(f, modulename, inputs, outputs);
+    std::vector<char *> vpBPats;
+    int nBPats = 0;
+    MapSim(args[1], inputs.size(), vpBPats, nBPats);
+    WriteSimPacked(packedname, vpBPats, nBPats);
+    return 0;
+  }
+
+  if(!params.fWarmStart) {
+    ctx.pHints = NULL;
+  }
+  VerifyStats stats;
+  if(params.fVerify) {
+    ctx.pVerify = &stats;
+  }
+  SweepStats sweep;
+  if(!params.vRarities.empty()) {
+    sweep.vNodes.resize(params.vRarities.size());
+    ctx.pSweep = &sweep;
+  }
+  BudgetStats budget;
+  if(params.budget || params.nBudgetBytes) {
+    ctx.pBudget = &budget;
+  }
+
+  if(batchname.empty()) {
+    std::string simname;
+    if(args.size() > 1) {
+      simname = args[1];
+    }
+    if(layerid.empty()) {
+      OptimizeBlif(args[0], simname, params, ctx);
+    } else {
+      OptimizeVerilog(args[0], layerid, simname, params, ctx);
+    }
+    return 0;
+  }
+
+  auto files = ReadBatch(batchname);
+  auto start = std::chrono::steady_clock::now();
+  for(uint i = 0; i < files.size(); i++) {
+    auto filestart = std::chrono::steady_clock::now();
+    int nGroups = OptimizeBlif(files[i].first, files[i].second, params, ctx);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - filestart;
+    std::cout << "[" << i + 1 << "/" << files.size() << "] " << files[i].first << " groups " << nGroups << " time " << elapsed.count() << std::endl;
+  }
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::cout << "batch files " << files.size() << " time " << elapsed.count() << std::endl;
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  Params params;
+  std::string batchname;
+  std::string layerid;
+  std::string packedname;
+  std::string socketname;
+  if(!ParseArgs(argc, argv, params, batchname, layerid, packedname, socketname)) {
+    return 1;
+  }
+  std::vector<std::string> args(argv + optind, argv + argc);
+  // the jobs of a server run in the directories of their clients, and write the cache and orders from there
+  if(!params.cachename.empty()) {
+    params.cachename = std::filesystem::absolute(params.cachename).string();
+  }
+  if(!params.ordersname.empty()) {
+    params.ordersname = std::filesystem::absolute(params.ordersname).string();
+  }
+
+  Context ctx;
+  std::unique_ptr<ResultCache> pCache;
+  if(!params.cachename.empty()) {
+    pCache.reset(new ResultCache(params.cachename, params.nCacheBytes));
+    ctx.pCache = pCache.get();
+  }
+  OrderHints hints;
+  ctx.pHints = &hints;
+  std::unique_ptr<ThreadPool> pPool;
+  if(params.nThreads) {
+    pPool.reset(new ThreadPool(params.nThreads));
+    ctx.pPool = pPool.get();
+  }
+  CareCache carecache(256ll << 20);
+  SetCareCache(&carecache);
+  ctx.pCareCache = &carecache;
+  OrderDatabase orders;
+  SetOrderDatabase(&orders);
+  if(!params.ordersname.empty() && std::filesystem::exists(params.ordersname) && !orders.Read(params.ordersname)) {
+    std::cerr << "cannot read " << params.ordersname << std::endl;
+    return 1;
+  }
+  size_t nOrders = orders.Size();
+  auto WriteOrders = [&]() {
+    if(params.ordersname.empty() || orders.Size() == nOrders) {
+      return;
+    }
+    if(!orders.Write(params.ordersname)) {
+      std::cerr << "cannot write " << params.ordersname << std::endl;
+    }
+    nOrders = orders.Size();
+  };
+
+  if(socketname.empty()) {
+    int r = 1;
+    try {
+      r = RunJob(params, batchname, layerid, packedname, args, ctx, argv[0]);
+    } catch(std::exception const &e) {
+      std::cerr << e.what() << std::endl;
+    }
+    WriteOrders();
+    SetOrderDatabase(NULL);
+    SetCareCache(NULL);
+    return r;
+  }
+
+  int r = Serve(socketname, [&](std::string const &kind, std::vector<std::string> const &jobargs, std::string const &body, std::ostream &out) {
+    std::vector<std::string> strs = {argv[0]};
+    strs.insert(strs.end(), jobargs.begin(), jobargs.end());
+    std::vector<char *> jobargv;
+    for(auto &str: strs) {
+      jobargv.push_back(&str[0]);
+    }
+    jobargv.push_back(NULL);
+    Params jobparams;
+    std::string jobbatchname, joblayerid, jobpackedname, jobsocketname;
+    int status = 1;
+    if(ParseArgs(strs.size(), jobargv.data(), jobparams, jobbatchname, joblayerid, jobpackedname, jobsocketname)) {
+      std::vector<std::string> jobfiles(strs.begin() + optind, strs.end());
+      if(kind == "group") {
+        if(jobfiles.empty()) {
+          Usage(argv[0]);
+        } else {
+          Context jobctx = ctx;
+          if(!jobparams.fWarmStart) {
+            jobctx.pHints = NULL;
+          }
+          status = OptimizeNames(body, jobfiles[0], jobfiles.size() > 1? jobfiles[1]: "", jobparams, jobctx, out);
+        }
+      } else {
+        status = RunJob(jobparams, jobbatchname, joblayerid, jobpackedname, jobfiles, ctx, argv[0]);
+      }
+    }
+    // sims rewritten since the last job are mapped again, and the care computed on the old mappings is dropped
+    if(ReleaseStaleSims()) {
+      carecache.Clear();
+    }
+    WriteOrders();
+    return status;
+  });
+  SetOrderDatabase(NULL);
+  SetCareCache(NULL);
+  return r;
+}